@@ -0,0 +1,451 @@
+/***
+==========================================================================================
+                      _              _         _____    _ _ _
+                     / \   _ __   __| |_   _  | ____|__| (_) |_
+                    / _ \ | '_ \ / _` | | | | |  _| / _` | | __|
+                   / ___ \| | | | (_| | |_| | | |__| (_| | | |_
+                  /_/   \_\_| |_|\__,_|\__, | |_____\__,_|_|\__|  v0.5-beta
+                                       |___/
+
+        Copyright 2020 (andrew.suttles@gmail.com)
+        MIT LICENSE
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+ INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE 
+ LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT 
+ OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ DEALINGS IN THE SOFTWARE.
+
+ AndyEDIT is a simple, line-oriented, terminal-based text editor with emacs-like keybindings.
+
+ For more information about AndyEdit, see README.md.
+
+==========================================================================================
+ ***/
+#define _DEFAULT_SOURCE			     /* madvise(), mkstemp() */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "ae.h"
+#include "arena.h"
+
+/***
+    Buffer Memory
+
+    Text appended to the buffer lives in an arena: 1 MB blocks that are
+    never moved or freed until the whole arena is released.  A text
+    offset names a block slot (offset >> ARENABITS) and a byte in it, so
+    text pointers stay valid as the arena grows.  Text bigger than a
+    block gets a run of slots of its own.
+
+    Line table nodes come from slabs of fixed-size objects, recycled
+    through a free list and released a block at a time.
+
+    Blocks of both are mapped from anonymous memory, so a released
+    block goes straight back to the system, until they hold the memory
+    budget (AE_MEMORY, or half of RAM).  Past that, blocks are mapped
+    from a private spill file, unlinked as soon as it is made, so the
+    kernel writes cold ones to the file rather than to swap.
+***/
+
+/* Module Constants */
+#define ARENABITS 20			     /* 1 MB Arena Blocks */
+#define ARENABLK  ((size_t)1 << ARENABITS)
+#define SLABOBJS  512			     /* Objects per Slab Block */
+#define SPILLHOT  4			     /* Newest Spill Blocks Kept by Trims */
+
+/* Block Header, Aligned for Any Object */
+typedef union {
+  struct {
+    size_t size;			     /* Bytes With Header */
+    size_t spill;			     /* Spill Table Index + 1, or 0 */
+  } b;
+  long double align;
+} blkhdr_t;
+
+/* Spilled Block */
+typedef struct {
+  void  *mem;				     /* NULL Once Released */
+  size_t size;
+} spill_t;
+
+/* Module Private Data */
+static size_t HEAPBYTES = 0;		     /* Block Bytes in Memory */
+static size_t BUDGET    = 0;		     /* Memory Limit, 0 Until Read */
+
+static struct {
+  int      fd;				     /* -1 Until the First Spill */
+  bool     failedP;			     /* Can't Spill, Use the Heap */
+  size_t   end;				     /* File Size */
+  size_t   live;			     /* Blocks Mapped */
+  spill_t *block;
+  size_t   n;
+  size_t   max;
+} SPILL = { .fd = -1 };
+
+/* Slab Block Header, Aligned for Any Object */
+typedef union _slabhdr {
+  union _slabhdr *next;			     /* Prior Block */
+  long double align;
+  void *ptr;
+} slabhdr_t;
+
+
+/*****************************************************************************************
+				       SPILL STORAGE
+*****************************************************************************************/
+
+/* Memory Budget From AE_MEMORY, in Bytes With K, M or G, or Half of RAM */
+size_t getMemoryBudget( void ) {
+
+  char *env, *end;
+  double n;
+
+  if( BUDGET ) return BUDGET;
+
+  if(( env = getenv( "AE_MEMORY" )) != NULL && ( n = strtod( env, &end )) > 0 ) {
+    switch( *end ) {
+    case 'g': case 'G': n *= 1024;	     /* Fall Through */
+    case 'm': case 'M': n *= 1024;	     /* Fall Through */
+    case 'k': case 'K': n *= 1024;
+    }
+    BUDGET = (size_t)n;
+  }
+  else {
+    long pages    = sysconf( _SC_PHYS_PAGES );
+    long pageSize = sysconf( _SC_PAGESIZE );
+
+    BUDGET = ( pages > 0 && pageSize > 0 ) ? (size_t)pages * pageSize / 2 : (size_t)1 << 30;
+  }
+
+  return BUDGET;
+}
+
+/* Open the Spill File, Unlinked So It Goes Away With the Editor */
+static bool _openSpill( void ) {
+
+  char path[256];
+  char *dir = getenv( "TMPDIR" );
+
+  if( SPILL.fd != -1 ) return true;
+  if( SPILL.failedP )  return false;
+
+  snprintf( path, sizeof( path ), "%s/ae-spill-XXXXXX", dir ? dir : "/var/tmp" );
+
+  if(( SPILL.fd = mkstemp( path )) == -1 ) {
+    SPILL.failedP = true;
+    return false;
+  }
+
+  unlink( path );
+  return true;
+}
+
+/* Map a Block From the End of the Spill File */
+static blkhdr_t *_spillBlock( size_t len ) {
+
+  blkhdr_t *h;
+  long pageSize = sysconf( _SC_PAGESIZE );
+
+  if( !_openSpill() ) return NULL;
+
+  len = ( len + pageSize - 1 ) / pageSize * pageSize;
+
+  if( ftruncate( SPILL.fd, SPILL.end + len ) == -1 )
+    return NULL;
+
+  h = mmap( NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, SPILL.fd, SPILL.end );
+  if( h == MAP_FAILED )
+    return NULL;
+
+  if( SPILL.n == SPILL.max ) {
+    SPILL.max = SPILL.max ? SPILL.max * 2 : 64;
+    if(( SPILL.block = realloc( SPILL.block, SPILL.max * sizeof( spill_t ))) == NULL )
+      die( "_spillBlock: realloc failed" );
+  }
+
+  SPILL.block[ SPILL.n ].mem  = h;
+  SPILL.block[ SPILL.n ].size = len;
+  SPILL.n++;
+  SPILL.live++;
+  SPILL.end += len;
+
+  h->b.size  = len;
+  h->b.spill = SPILL.n;
+  return h;
+}
+
+/* Get a Block, From the Spill File Once Memory Holds the Budget */
+static void *_blockAlloc( size_t size ) {
+
+  blkhdr_t *h = NULL;
+  size_t len  = sizeof( blkhdr_t ) + size;
+
+  if( HEAPBYTES + len > getMemoryBudget() )
+    h = _spillBlock( len );
+
+  if( h == NULL ) {
+    h = mmap( NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+    if( h == MAP_FAILED )
+      return NULL;
+    h->b.size  = len;
+    h->b.spill = 0;
+    HEAPBYTES += len;
+  }
+
+  return h + 1;
+}
+
+/* Release a Block, Emptying the Spill File When It Was the Last */
+static void _blockFree( void *mem ) {
+
+  blkhdr_t *h = (blkhdr_t *)mem - 1;
+
+  if( h->b.spill == 0 ) {
+    HEAPBYTES -= h->b.size;
+    munmap( h, h->b.size );
+    return;
+  }
+
+  SPILL.block[ h->b.spill - 1 ].mem = NULL;
+  munmap( h, h->b.size );
+
+  if( --SPILL.live == 0 ) {
+    if( ftruncate( SPILL.fd, 0 ) == -1 )
+      SPILL.failedP = true;		     /* Stop Growing It */
+    SPILL.end = 0;
+    SPILL.n   = 0;
+  }
+}
+
+/* Bytes Mapped From the Spill File */
+size_t getSpillBytes( void ) {
+
+  return SPILL.end;
+}
+
+/* Bytes of Blocks in Memory */
+size_t getHeapBlockBytes( void ) {
+
+  return HEAPBYTES;
+}
+
+/* Let the Kernel Reclaim Mapped Pages Now, Reading Them Back on Use */
+void dropResidentPages( void *mem, size_t len ) {
+
+#if defined(MADV_PAGEOUT)
+  madvise( mem, len, MADV_PAGEOUT );
+#else
+  madvise( mem, len, MADV_DONTNEED );
+#endif
+}
+
+/* Push Spilled Blocks Out to the File, Except the Newest */
+void trimSpill( void ) {
+
+  for( size_t i = 0; i + SPILLHOT < SPILL.n; i++ )
+    if( SPILL.block[i].mem )
+      dropResidentPages( SPILL.block[i].mem, SPILL.block[i].size );
+}
+
+
+/*****************************************************************************************
+				        TEXT ARENA
+*****************************************************************************************/
+
+/* Record a New Allocation */
+static void _addAlloc( arena_t *a, char *mem ) {
+
+  if( a->nAlloc == a->maxAlloc ) {
+    a->maxAlloc = a->maxAlloc ? a->maxAlloc * 2 : 16;
+    if(( a->alloc = realloc( a->alloc, a->maxAlloc * sizeof( char * ))) == NULL )
+      die( "_addAlloc: realloc failed" );
+  }
+
+  a->alloc[ a->nAlloc++ ] = mem;
+}
+
+/* Make Sure need Contiguous Bytes Are Free at a->used, Return Their Offset */
+size_t arenaReserve( arena_t *a, size_t need ) {
+
+  size_t i, size, first, slots;
+  char *mem;
+
+  if( a->used + need <= a->end )
+    return a->used;
+
+  /* Start a New Block, Big Text Gets a Run of Slots */
+  size  = (( need + ARENABLK - 1 ) >> ARENABITS ) << ARENABITS;
+  size  = size ? size : ARENABLK;
+  first = a->end >> ARENABITS;
+  slots = size >> ARENABITS;
+
+  if(( mem = _blockAlloc( size )) == NULL )
+    die( "arenaReserve: block allocation failed" );
+  _addAlloc( a, mem );
+
+  if( first + slots > a->maxSlots ) {
+    while( first + slots > a->maxSlots )
+      a->maxSlots = a->maxSlots ? a->maxSlots * 2 : 64;
+    if(( a->slot = realloc( a->slot, a->maxSlots * sizeof( char * ))) == NULL )
+      die( "arenaReserve: realloc failed" );
+  }
+
+  for( i = 0; i<slots; i++ )
+    a->slot[ first + i ] = mem + ( i << ARENABITS );
+
+  a->used = a->end;
+  a->end += size;
+
+  return a->used;
+}
+
+/* Copy Text to the End of the Arena, Return Its Offset */
+size_t arenaAppend( arena_t *a, const char *txt, size_t len ) {
+
+  size_t off = arenaReserve( a, len );
+
+  memcpy( arenaPtr( a, off ), txt, len );
+  a->used = off + len;
+
+  return off;
+}
+
+/* Pointer to Arena Text at off */
+char *arenaPtr( arena_t *a, size_t off ) {
+
+  return a->slot[ off >> ARENABITS ] + ( off & ( ARENABLK - 1 ));
+}
+
+/* Can Text at off Grow to len Bytes Without Leaving Its Block? */
+bool arenaFitsP( arena_t *a, size_t off, size_t len ) {
+
+  return ( off + len <= a->end );
+}
+
+/* Bytes Reserved by the Arena */
+size_t arenaBytes( arena_t *a ) {
+
+  return a->end;
+}
+
+/***
+    Read-Only View of the Arena
+
+    The view has its own copy of the slot table, so arenaPtr on the view
+    stays safe in another thread while the arena grows.  Blocks stay
+    owned by the arena; arenaRelease on the view frees only the copy.
+***/
+arena_t arenaView( arena_t *a ) {
+
+  arena_t v;
+  size_t slots = a->end >> ARENABITS;
+
+  memset( &v, 0, sizeof( arena_t ));
+
+  if( slots ) {
+    if(( v.slot = malloc( slots * sizeof( char * ))) == NULL )
+      die( "arenaView: malloc failed" );
+    memcpy( v.slot, a->slot, slots * sizeof( char * ));
+  }
+
+  v.maxSlots = slots;
+  v.used     = a->used;
+  v.end      = a->end;
+
+  return v;
+}
+
+/* Free Every Block at Once */
+void arenaRelease( arena_t *a ) {
+
+  for( size_t i = 0; i<a->nAlloc; i++ )
+    _blockFree( a->alloc[i] );
+
+  free( a->alloc );
+  free( a->slot );
+  memset( a, 0, sizeof( arena_t ));
+}
+
+
+/*****************************************************************************************
+				       OBJECT SLABS
+*****************************************************************************************/
+
+/* Get an Object From the Slab */
+void *slabAlloc( slab_t *s ) {
+
+  void *obj;
+  slabhdr_t *blk;
+
+  s->live++;
+
+  /* Reuse a Freed Object */
+  if( s->freeList ) {
+    obj = s->freeList;
+    s->freeList = *(void **)obj;
+    return obj;
+  }
+
+  /* Carve a New Block */
+  if( s->block == NULL || s->carved == SLABOBJS ) {
+
+    if(( blk = _blockAlloc( sizeof( slabhdr_t ) + SLABOBJS * s->size )) == NULL )
+      die( "slabAlloc: block allocation failed" );
+
+    blk->next = s->block;
+    s->block  = blk;
+    s->carved = 0;
+    s->blocks++;
+  }
+
+  blk = s->block;
+  return (char *)( blk + 1 ) + s->size * s->carved++;
+}
+
+/* Return an Object to the Slab */
+void slabFree( slab_t *s, void *obj ) {
+
+  *(void **)obj = s->freeList;
+  s->freeList   = obj;
+  s->live--;
+}
+
+/* Bytes Reserved by the Slab */
+size_t slabBytes( slab_t *s ) {
+
+  return s->blocks * ( sizeof( slabhdr_t ) + SLABOBJS * s->size );
+}
+
+/* Free Every Block at Once */
+void slabRelease( slab_t *s ) {
+
+  slabhdr_t *blk, *next;
+
+  for( blk = s->block; blk; blk = next ) {
+    next = blk->next;
+    _blockFree( blk );
+  }
+
+  s->block    = NULL;
+  s->freeList = NULL;
+  s->carved   = 0;
+  s->blocks   = 0;
+  s->live     = 0;
+}
+
+
+/***
+    Local Variables:
+    mode: c
+    tags-file-name: "~/ae/TAGS"
+    comment-column: 45
+    fill-column: 90
+    End:
+ ***/
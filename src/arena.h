@@ -0,0 +1,42 @@
+/* Append-Only Text Arena */
+typedef struct {
+  char  **slot;				/* Block Start per Slot */
+  size_t  maxSlots;
+  char  **alloc;			/* Blocks to Free */
+  size_t  nAlloc;
+  size_t  maxAlloc;
+  size_t  used;				/* Next Free Offset */
+  size_t  end;				/* End of Last Block */
+} arena_t;
+
+/* Fixed-Size Object Slab */
+typedef struct {
+  size_t size;				/* Object Size */
+  void  *freeList;			/* Freed Objects */
+  void  *block;				/* Newest Block */
+  size_t carved;			/* Objects Carved From Newest Block */
+  size_t blocks;			/* Blocks Allocated */
+  size_t live;				/* Objects in Use */
+} slab_t;
+
+/* Text Arena */
+size_t arenaReserve( arena_t *, size_t );
+size_t arenaAppend( arena_t *, const char *, size_t );
+char *arenaPtr( arena_t *, size_t );
+bool arenaFitsP( arena_t *, size_t, size_t );
+size_t arenaBytes( arena_t * );
+arena_t arenaView( arena_t * );
+void arenaRelease( arena_t * );
+
+/* Object Slabs */
+void *slabAlloc( slab_t * );
+void slabFree( slab_t *, void * );
+size_t slabBytes( slab_t * );
+void slabRelease( slab_t * );
+
+/* Spill Storage */
+size_t getMemoryBudget( void );
+size_t getSpillBytes( void );
+size_t getHeapBlockBytes( void );
+void dropResidentPages( void *, size_t );
+void trimSpill( void );
@@ -23,14 +23,23 @@
 
 ==========================================================================================
  ***/
-#define _POSIX_C_SOURCE 200809L		     /* getline() is POSIX */
+#define _POSIX_C_SOURCE 200809L		     /* mkstemp(), fsync() are POSIX */
 
 #include <stdbool.h>
 #include <curses.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
 
 #include "ae.h"
 #include "buffer.h"
@@ -40,32 +49,112 @@
 #include "state.h"
 #include "edit.h"
 #include "window.h"
+#include "arena.h"
+#include "lineTable.h"
+#include "lineScan.h"
+#include "lineCache.h"
+#include "journal.h"
+#include "undo.h"
+#include "viewFile.h"
 
 /* Module Constants */
-#define MXRWS 512			     /* Initial Buffer Size = 512 Rows */
+#define BIGFILE (1 << 24)		     /* Report Load/Save Speed From 16 MB */
+#define SAVEIOV 512			     /* Lines Gathered per writev */
+#define SAVEBATCH (1 << 22)		     /* Bytes Gathered per writev */
+#define INPLACEMIN 0.75			     /* Share of File a Save in Place Keeps */
+#define VIEWMIN 1.0			     /* Share of RAM Opening Read-Only */
+#define TRIMSECS 5.0			     /* Least Interval Between Trims */
+#define HOTROWS 4096			     /* Rows Kept Unpacked Around Screen */
+#define INTERNMIN 1024			     /* Least Intern Table Slots */
+#define CHUNKLINE (1 << 20)		     /* Lines Longer Are Chunked on Edit */
+#define CHUNKMAX  (1 << 16)		     /* Most Bytes per Chunk */
 
-/* Module Private Data */
-static row_t **BUFFER = NULL;		     /* File Buffer */
-static int MAXROWS  = MXRWS;		     /* MAX Number of Buffer Lines */
-static int NUMROWS  = 0;		     /* Num Rows in Text Buffer */
+/***
+    Piece Table Text Storage
+
+    Every row references a span of text in one of two buffers.  The
+    ORIGINAL buffer is the file mapped read-only into memory, so opening
+    a file only builds the line index.  The ADD buffer is append-only;
+    edited and new text is appended to its end, in arena blocks that
+    never move.  Bytes below ADDFROZEN are shared by more than one row
+    and must not be rewritten in place.
+
+    Lines of up to INLINEMAX bytes that are edited or created are kept
+    in the row itself, in place of the text offset.
+
+    Only the row under edit has a gap, so its gap pointers live in
+    EDITROW rather than in every line of the table.  Typed text gathers
+    in the edit buffer until the point leaves the gap; the row then
+    stays last in the ADD buffer, so committing it moves the text after
+    the gap in place rather than copying the line.
+
+    Very long lines are held as lists of chunks once edited; see
+    CHUNKED LINES.
+***/
+#define INLINEMAX sizeof( size_t )	     /* Longest Inline Line */
+
+static char  *ORIGBUFFER = NULL;	     /* File Text As Read */
+static size_t ORIGLENGTH = 0;
+static bool   ORIGMAPPEDP = false;	     /* ORIGBUFFER From mmap? */
+static arena_t ADDBUFFER;		     /* Appended Text */
+static size_t ADDFROZEN  = 0;		     /* Start of Private Text */
+
+static row_t TEXTROW;			     /* Holds Inline Text for Callers */
+static unsigned long BUFFERGEN = 0;	     /* Bumped on Every Text Change */
 
-static char *KILLBUFFER = NULL;		     /* Line of Killed Text */
-static int  KILLBUFFERLENGTH = 0;	     /* Length of Killed Text */
+/***
+    Saving in Place
+
+    Rows before BASEROW are unedited file lines, end to end from the
+    start of the file.  Rows before LOWROW are unchanged since the last
+    save.  While the file on disk is the one DISKFILE describes, a save
+    only rewrites it from the byte offset of LOWROW on.
+***/
+static int BASEROW = 0;			     /* Rows Before Are File Text */
+static int LOWROW  = 0;			     /* First Row Changed Since Save */
+
+static struct {				     /* File the Buffer Was Saved To */
+  bool   knownP;
+  dev_t  dev;
+  ino_t  ino;
+  off_t  size;
+  struct timespec mtime;
+} DISKFILE;
+
+static dev_t ORIGDEV;			     /* File Mapped as ORIGBUFFER */
+static ino_t ORIGINO;
+
+static struct {				     /* Active Edit Row */
+  int  row;				     /* Row With Gap, -1 if None */
+  int  lPtr;				     /* Editor Pointers */
+  int  rPtr;
+  bool editP;				     /* Row Edited Predicate */
+} EDITROW = { -1, 0, 0, false };
+
+/* Private Functions */
+static char *_flatText( const row_t * );
+static bool _holdRowText( const row_t * );
+static void _privateKills( void );
+static void _splitRow( int, int );
 
 /*****************************************************************************************
 				     TEXT BUFFER ROWS
 *****************************************************************************************/
 
-/* Update the Number of Lines in Buffer File */
+/* Truncate Buffer File to x Lines */
 void setBufferNumRows( int x ) {
 
-  NUMROWS = x;
+  deleteLineTableRows( x, getLineTableRows() - x );
+  BUFFERGEN++;
 }
 
 /* Get Number of Rows In Buffer File */
 int getBufferNumRows( void ) {
 
-  return NUMROWS;
+  if( fileViewP() )
+    return getFileViewRows();
+
+  return getLineTableRows();
 }
 
 /* Get BUFFER Row Index for Line With POINT */
@@ -80,541 +169,2706 @@ int getBufferCol( void ) {
 }
 
 /*****************************************************************************************
-				       TAB HANDLING
+				    PIECE TABLE STORAGE
 *****************************************************************************************/
 
-/* Convert Tabs to Spaces */
-static char *removeTabs( char *line ) {
+/* Get Row Structure */
+static row_t _row( int row ) {
 
-  size_t i;
+  return getLineTableRow( row );
+}
 
-  size_t countTabs = 0;
-  size_t len = strlen( line );
-  
-  /* Count the Number of Tabs */
-  for( i = 0; i<len; i++ ) {
-    if( line[i] == '\t' ) {
-      countTabs++;
-    }
-  }
+/* Get Pointer to Row Text, Inline Text Points Into r Itself */
+static char *_rowText( const row_t *r ) {
 
-  /* Return if No Tabs Found */
-  if( countTabs == 0 ) return line;
+  if( r->src == INLINETEXT )
+    return (char *)&r->off;
 
-  /* Create Space for 'Newline' Without Tabs */
-  char *newline = malloc(( sizeof( char ) *
-                           ( len + ( countTabs * 7 ))) + 1 );
-  size_t j;
-  size_t index = 0;
+  if( r->src == CHUNKTEXT )
+    return _flatText( r );
 
-  /* Copy Line to Newline With Spaces */
-  for( i = 0; i<len; i++ ) {
+  if( r->src == ADDTEXT )
+    return arenaPtr( &ADDBUFFER, r->off );
 
-    if( line[i] == '\t' ) {        /* Tabs Found */
-      for( j = 0; j<8; j++ ) {
-        newline[index] = ' ';
-        index++;
-      }
-    }
-    else {                        /* Not a Tab */
-      newline[index] = line[i];
-      index++;
-    }
-  }
+  return ORIGBUFFER + r->off;
+}
 
-  newline[index] = '\0';
-  free( line );                        /* Delete Old Line */
+/* Note a Change at row, and in Any Rows After It */
+static void _changedRow( int row ) {
 
-  return newline;		       /* Save New Line */
+  if( row < LOWROW )  LOWROW  = row;
+  if( row < BASEROW ) BASEROW = row;
 }
 
-/*****************************************************************************************
-				    BUFFER MANAGEMENT
- *****************************************************************************************/
-
-/* Setup Buffer Data Structure */
-void initializeBuffer( void ) {
+/* Store Row Structure */
+static void _setRow( int row, row_t r ) {
 
-  /* Reserve Heap Space for Buffer */
-  if(( BUFFER = calloc( (size_t)MXRWS, sizeof( row_t * ))) == NULL )
-    die( "initializeData: BUFFER malloc failed" );
+  setLineTableRow( row, r );
+  BUFFERGEN++;
+  _changedRow( row );
+  journalSetRow( row, _rowText( &r ), r.len );
 }
 
+/* Store Row Structure Changed by a Splice, Journaling Only the Splice */
+static void _spliceRow( int row, row_t r, int left, int right, const char *txt, int len ) {
+
+  setLineTableRow( row, r );
+  BUFFERGEN++;
+  _changedRow( row );
+  journalSpliceRow( row, left, right, txt, len );
+}
 
-/* ! DEPRACATED - Bad Practice */
-/* Return Pointer to Text BUFFER */
-buff_t getBufferHandle( void ) {
+/* Store Short Text in the Row Itself */
+static void _setInlineText( row_t *r, const char *txt, size_t len ) {
 
-  return BUFFER;
+  r->src = INLINETEXT;
+  r->off = 0;
+  r->len = len;
+  memcpy( &r->off, txt, len );
 }
 
+/* Row is the Last, Unshared Text in ADD Buffer? */
+static bool _rowAtAddTailP( const row_t *r ) {
 
-/* Open AE on an Empty Buffer */
-void openEmptyBuffer( enum _bn bn ) {
+  return ( r->src == ADDTEXT         &&
+	   r->off >= ADDFROZEN       &&
+	   r->off + r->len == ADDBUFFER.used );
+}
 
+/* Add a Scanned Row, Referencing the File Text As Is */
+static void _addScannedRow( size_t off, size_t len ) {
 
-  BUFFER[0] = malloc( sizeof( row_t ));
-  BUFFER[0]->txt = malloc( sizeof( char ) * 2 );
-  BUFFER[0]->txt[0] = '\n';
-  BUFFER[0]->txt[1] = '\0';
-  BUFFER[0]->len    = 1;
-  BUFFER[0]->lPtr   = 0;
-  BUFFER[0]->rPtr   = 0;
-  BUFFER[0]->editP  = false;
+  row_t r = { off, len, ORIGTEXT };
 
-  if( bn == DEFAULT )
-    setDefaultFilename();
+  appendLineTableRow( r );
+}
 
-  setBufferNumRows( 1 );
+/* Build Line Table Over the ORIGINAL Buffer, Read From fn */
+static void _indexLines( const char *fn, const struct stat *sb ) {
+
+  scanCachedLines( fn, sb, ORIGBUFFER, ORIGLENGTH, _addScannedRow );
+  BUFFERGEN++;
 }
 
-/* Read A Text File from Disk */
-void readBufferFile( char * fn ) {
+/* Map File Into ORIGINAL Buffer, Reading It If It Cannot Be Mapped */
+static void _loadOriginalText( int fd, size_t len ) {
 
-  int i = 0;
-  FILE *fp = NULL;
-  
-  /* Check to See if File Exists and Readable */
-  if( access( fn, R_OK | F_OK ) == -1 ) {
+  ssize_t n;
+  size_t got = 0;
 
-    miniBufferMessage( "Filename doesn't exist. Creating buffer for new file." );
-    openEmptyBuffer( UNAMED );
+  ORIGLENGTH  = len;
+  ORIGMAPPEDP = false;
+
+  if( len == 0 ) return;
+
+  ORIGBUFFER = mmap( NULL, len, PROT_READ, MAP_PRIVATE, fd, 0 );
+  if( ORIGBUFFER != MAP_FAILED ) {
+    ORIGMAPPEDP = true;
     return;
   }
-  
-  /* Open File for Editing */
-  if(( fp = fopen( fn, "r" )) == NULL ) {
-    die( "openBuffer: fopen failed." );
+
+  if(( ORIGBUFFER = malloc( len )) == NULL )
+    die( "openBuffer: ORIGBUFFER malloc failed" );
+
+  while( got < len ) {
+    if(( n = read( fd, ORIGBUFFER + got, len - got )) <= 0 )
+      die( "openBuffer: read failed." );
+    got += n;
   }
+}
 
-  /* Read File Rows into BUFFER */
-  while( true ) {
+/* Release ORIGINAL Buffer */
+static void _freeOriginalText( void ) {
 
-    /* Check Buffer Size */
-    if( i == MAXROWS ) {        
-      doubleBufferSize();
-    }
+  if( ORIGMAPPEDP )
+    munmap( ORIGBUFFER, ORIGLENGTH );
+  else
+    free( ORIGBUFFER );
 
+  ORIGBUFFER  = NULL;
+  ORIGLENGTH  = 0;
+  ORIGMAPPEDP = false;
+}
 
-    /* Delete Previously Allocated BUFFER Lines */
-    if( BUFFER[i] != NULL ) {
-      free( BUFFER[i]->txt );
-      free( BUFFER[i] );
-    }
-    
-    /* Reserve Heap Space for Text Row  */
-    BUFFER[i] = malloc( sizeof( row_t ));
-    BUFFER[i]->len   = 0;
-    BUFFER[i]->lPtr  = 0;
-    BUFFER[i]->rPtr  = 0;
-    BUFFER[i]->editP = false;
-    BUFFER[i]->txt   = NULL;
-
-    /* Read Next Text Row */
-    if( getline( &BUFFER[i]->txt, &BUFFER[i]->len, fp ) == ERR ) {
-      free( BUFFER[i]->txt );		     /* Free Unused i'th BUFFER */
-      free( BUFFER[i] );		     
-      break;
-    }
 
-    /* Clean-up Tabs and Set Length */
-    BUFFER[i]->txt = removeTabs( BUFFER[i]->txt );
-    BUFFER[i]->len = strlen( BUFFER[i]->txt );
+/*****************************************************************************************
+				     LINE INTERNING
+*****************************************************************************************/
 
-    i++;                        /* Line Counter */
+/***
+    Line Interning
+
+    With AE_INTERN set, a line written to the ADD buffer whose text is
+    already there, in another row, references that copy instead.  The
+    table is keyed by a hash of the text and every hit is compared byte
+    for byte, since text may have been edited or given back since it
+    was entered.  A hit freezes the ADD text, so the first edit of any
+    row sharing it copies the line.
+***/
+typedef struct {
+  size_t   off;				     /* ADD Text, len 0 If Empty */
+  size_t   len;
+  uint64_t hash;
+} intern_t;
+
+static struct {
+  int       onP;			     /* -1 Until AE_INTERN Read */
+  intern_t *slot;
+  size_t    max;			     /* Slots, a Power of Two */
+  size_t    n;				     /* Slots Filled */
+  size_t    hits;			     /* Lines Sharing Text */
+  size_t    bytes;			     /* Text Not Copied */
+} INTERN = { -1, NULL, 0, 0, 0, 0 };
+
+/* Interning Mode On? */
+static bool _internP( void ) {
+
+  char *env;
+
+  if( INTERN.onP < 0 ) {
+    env = getenv( "AE_INTERN" );
+    INTERN.onP = ( env && *env && strcmp( env, "0" ) != 0 );
   }
-  
-  setBufferNumRows( i );
 
-  fclose(fp);
+  return INTERN.onP;
 }
 
+/* FNV-1a Hash of a Line */
+static uint64_t _hashText( const char *txt, size_t len ) {
 
-/* Save Buffer Lines */
-void saveBuffer() {
+  uint64_t h = 14695981039346656037u;
+  const unsigned char *p = (const unsigned char *)txt;
+  size_t i;
 
-  int row;
-  char msgBuffer[ 128 ];
+  for( i = 0; i<len; i++ )
+    h = ( h ^ p[i] ) * 1099511628211u;
 
-  FILE *fp = NULL;
-  int numRows = getBufferNumRows();
-  
-  /* Open File for Editing */
-  if(( fp = fopen( getBufferFilename(), "w" )) == NULL ) {
-    die( "saveBuffer: fopen failed." );
-  }
+  return h;
+}
 
-  for( row = 0; row<numRows; row++ ) {
-    fprintf( fp, "%s", BUFFER[row]->txt );
-  }
+/* Double the Table, Dropping Text Given Back */
+static void _growIntern( void ) {
 
-  fclose( fp );
+  intern_t *old = INTERN.slot;
+  size_t oldMax = INTERN.max;
+  size_t i, j;
 
-  setStatusFlagOriginal();
+  INTERN.max = oldMax ? oldMax * 2 : INTERNMIN;
+  INTERN.n   = 0;
 
-  snprintf( msgBuffer, 128, "Wrote %d lines to %s", row, getBufferFilename() );
-  miniBufferMessage( msgBuffer );
+  if(( INTERN.slot = calloc( INTERN.max, sizeof( intern_t ))) == NULL )
+    die( "_growIntern: calloc failed" );
+
+  for( i = 0; i<oldMax; i++ ) {
+    if( old[i].len == 0 || old[i].off + old[i].len > ADDBUFFER.used )
+      continue;
+    for( j = old[i].hash & ( INTERN.max - 1 ); INTERN.slot[j].len;
+	 j = ( j + 1 ) & ( INTERN.max - 1 ))
+      ;
+    INTERN.slot[j] = old[i];
+    INTERN.n++;
+  }
+
+  free( old );
 }
 
+/***
+    Find txt in ADD Text Ending By end
 
-/* Save Buffer Lines */
-void saveBufferNewName( void ) {
+    Returns its slot and sets *hitP, or else returns the slot to record
+    it in, reusing one whose text was given back.
+***/
+static intern_t *_findIntern( const char *txt, size_t len, uint64_t h,
+			      size_t end, bool *hitP ) {
 
-  int row;
-  char msgBuffer[ 128 ];
-  
-  FILE *fp = NULL;
-  char *fn = getBufferFilename();
+  intern_t *s, *reuse = NULL;
+  size_t i;
 
-  int numRows = getBufferNumRows();
+  if( INTERN.n * 2 >= INTERN.max )
+    _growIntern();
 
-  
-  /* Get Filename to Write */
-  miniBufferGetFilename();
+  for( i = h & ( INTERN.max - 1 ); INTERN.slot[i].len; i = ( i + 1 ) & ( INTERN.max - 1 )) {
 
-  /* Open File for Editing */
-  if(( fp = fopen( fn, "w" )) == NULL ) {
-    die( "saveBufferNewName: fopen failed." );
-  }
+    s = &INTERN.slot[i];
 
-  for( row = 0; row<numRows; row++ ) {
-    fprintf( fp, "%s", BUFFER[row]->txt );
+    if( s->off + s->len > ADDBUFFER.used ) {
+      if( !reuse ) reuse = s;
+    }
+    else if( s->hash == h && s->len == len && s->off + len <= end &&
+	     memcmp( arenaPtr( &ADDBUFFER, s->off ), txt, len ) == 0 ) {
+      *hitP = true;
+      return s;
+    }
   }
 
-  fclose( fp );
+  *hitP = false;
+  return reuse ? reuse : &INTERN.slot[i];
+}
+
+/* Record ADD Text in a Slot _findIntern Returned */
+static void _recordIntern( intern_t *s, size_t off, size_t len, uint64_t h ) {
 
-  setStatusFlagOriginal();
+  if( s->len == 0 )
+    INTERN.n++;
 
-  snprintf( msgBuffer, 128, "Wrote %d lines to %s", row, getBufferFilename() );
-  miniBufferMessage( msgBuffer );
+  s->off  = off;
+  s->len  = len;
+  s->hash = h;
 }
 
+/* Count a Hit and Freeze the Text It Shares */
+static void _shareIntern( size_t len ) {
 
-/* Double Buffer Size */
-void doubleBufferSize( void ) {
-  
-  int newMaxRows = MAXROWS * 2;        /* Double Buffer Size */
-    
-  if(( BUFFER = realloc( BUFFER, newMaxRows * sizeof( row_t *))) == NULL )
-    die( "doubleBufferSize: realloc failed" );
-
-  MAXROWS = newMaxRows;
+  INTERN.hits++;
+  INTERN.bytes += len;
+  ADDFROZEN = ADDBUFFER.used;
 }
 
+/* Offset of txt Appended to ADD Buffer, or of a Copy Already There */
+static size_t _addText( const char *txt, size_t len ) {
 
-/* Adjust Buffer Size, If Needed */
-bool bufferFullP( void ) {
+  bool hitP;
+  size_t off;
+  uint64_t h;
+  intern_t *s;
 
-  if( getBufferNumRows() == MAXROWS ) {        
-    return true;
+  if( !_internP() )
+    return arenaAppend( &ADDBUFFER, txt, len );
+
+  h = _hashText( txt, len );
+  s = _findIntern( txt, len, h, ADDBUFFER.used, &hitP );
+
+  if( hitP ) {
+    _shareIntern( len );
+    return s->off;
   }
 
-  return false;
+  off = arenaAppend( &ADDBUFFER, txt, len );
+  _recordIntern( s, off, len, h );
+
+  return off;
 }
 
+/* Point r at a Copy of Its Text Already in ADD Buffer, or Record It */
+static void _internRow( row_t *r ) {
 
-/* Close Text Buffer */
-void closeBuffer( void ) {
+  bool hitP;
+  bool tailP;
+  uint64_t h;
+  intern_t *s;
+  const char *txt;
 
-  int i;
+  if( !_internP() || r->src != ADDTEXT )
+    return;
 
-  int numRows = getBufferNumRows();
-  
-  for( i=0; i<numRows; i++ ) {
-    free( BUFFER[i]->txt );
-    free( BUFFER[i] );
+  /* Private Tail Text is Given Back on a Hit */
+  tailP = _rowAtAddTailP( r );
+  txt   = arenaPtr( &ADDBUFFER, r->off );
+  h     = _hashText( txt, r->len );
+  s     = _findIntern( txt, r->len, h, tailP ? r->off : ADDBUFFER.used, &hitP );
+
+  if( !hitP ) {
+    _recordIntern( s, r->off, r->len, h );
+    return;
   }
 
-  free( BUFFER );
-  BUFFER = (buff_t)NULL;
+  if( s->off == r->off )		     /* Already Its Own Entry */
+    return;
 
-  MAXROWS    = MXRWS;
-  setBufferNumRows( 0 );
-  setPointX( 0 );
-  setPointY( 0 );
-  setMarkX( -1 );
-  setMarkY( -1 );
-  setRowOffset( 0 );
-  setColOffset( 0 );
-  setEditBufferIndex( 0 );
-  setRegionActive( false );
-  setStatusFlagOriginal();
+  if( tailP )
+    ADDBUFFER.used = r->off;
 
-  /* Free the KILLBUFFER */
-  emptyKillBuffer();
-  
-  clear();
+  r->off = s->off;
+  _shareIntern( r->len );
 }
 
-/***
-    Close Current Buffer 
-    and Open Empty Buffer
- ***/
-
-void killBuffer( void ) {
-
-  closeBuffer();
+/* Forget Interned Text */
+static void _freeIntern( void ) {
 
-  initializeBuffer();
-  
-  openEmptyBuffer( DEFAULT );
-  
-  clear();
+  free( INTERN.slot );
+  INTERN.slot  = NULL;
+  INTERN.max   = INTERN.n = 0;
+  INTERN.hits  = INTERN.bytes = 0;
 }
 
+
 /*****************************************************************************************
-				    BUFFER PROPERTIES
+				      CHUNKED LINES
 *****************************************************************************************/
-int getBufferLineLen( int row ) {
 
-  return BUFFER[row]->len;
+/***
+    Chunked Lines
+
+    A line growing past CHUNKLINE on an edit is split into a list of
+    chunks, each referencing up to CHUNKMAX bytes of ORIGINAL or ADD
+    text, and the row holds the list.  An edit cuts and rewrites only
+    the chunks it touches, so it costs about a chunk, not the line.
+    Readers walk the line a span at a time (see getBufferTextSpan);
+    callers wanting the whole line get a copy, made once per change.
+
+    A snapshot may read the lists in use when it was taken from another
+    thread, so a list is copied before its first edit after one, while
+    that snapshot lasts.  Lists given up are freed once no snapshot can
+    read them; those of deleted rows stay until closeBuffer, as their
+    text does.  Undo and the kill ring hold a row by its list, which is
+    then never edited again: a row using it copies the list, not the
+    text, before its next edit, and the list stays until closeBuffer.
+***/
+typedef struct {
+  row_t  *piece;			     /* ORIG or ADD Text, in Order */
+  size_t *at;				     /* Column Each Chunk Starts At */
+  int     n;
+  int     max;
+  size_t  len;				     /* Bytes in Line */
+  unsigned long epoch;			     /* Snapshot Epoch Made In */
+  unsigned long diedAt;			     /* Epoch Given Up In */
+  unsigned long stamp;			     /* Changes With the Text */
+  int     slot;				     /* Index in CHUNKS.list */
+  bool    deadP;			     /* Given Up, Snapshot May Read */
+  bool    heldP;			     /* Held by Undo or a Kill */
+} chunk_t;
+
+static struct {				     /* Every Chunk List */
+  chunk_t **list;
+  int       n;
+  int       max;
+  unsigned long *snapAt;		     /* Epoch Each Snapshot Began */
+  int       snaps;			     /* Snapshots Not Yet Released */
+  int       snapMax;
+  unsigned long epoch;			     /* Bumped by Each Snapshot */
+  unsigned long stamp;
+} CHUNKS;
+
+static struct {				     /* Whole Copy of a Chunked Line */
+  char  *txt;
+  size_t size;
+  unsigned long stamp;			     /* Of the Line Copied, 0 If None */
+} FLAT;
+
+/* Chunk List of a Chunked Row */
+static chunk_t *_chunkOf( const row_t *r ) {
+
+  return (chunk_t *)(uintptr_t)r->off;
 }
 
-char getBufferChar( int row, int col ) {
+/* New Empty Chunk List */
+static chunk_t *_newChunks( void ) {
 
-  return BUFFER[ row ]->txt[ col ];
-}
-void setBufferChar( int row, int col, char c ) {
+  chunk_t *c;
 
-  BUFFER[row]->txt[ col ] = c;
-}
+  if(( c = calloc( 1, sizeof( chunk_t ))) == NULL )
+    die( "_newChunks: calloc failed" );
 
-char *getBufferTextLine( int row ) {
+  if( CHUNKS.n == CHUNKS.max ) {
+    CHUNKS.max = CHUNKS.max ? CHUNKS.max * 2 : 16;
+    if(( CHUNKS.list = realloc( CHUNKS.list, CHUNKS.max * sizeof( chunk_t * ))) == NULL )
+      die( "_newChunks: realloc failed" );
+  }
+
+  c->epoch = CHUNKS.epoch;
+  c->stamp = ++CHUNKS.stamp;
+  c->slot  = CHUNKS.n;
+  CHUNKS.list[ CHUNKS.n++ ] = c;
 
-  return BUFFER[ row ]->txt;
+  return c;
 }
 
-bool bufferLineModifiedP( int row ) {
+static void _freeChunks( chunk_t *c ) {
+
+  CHUNKS.list[ c->slot ] = CHUNKS.list[ --CHUNKS.n ];
+  CHUNKS.list[ c->slot ]->slot = c->slot;
 
-  return ( BUFFER[row]->lPtr != BUFFER[row]->rPtr );
+  free( c->piece );
+  free( c->at );
+  free( c );
 }
 
-bool bufferRowEditedP( int row ) {
+/* May a Snapshot Still Held Read c, In Use Until Epoch upto? */
+static bool _snapReadsP( const chunk_t *c, unsigned long upto ) {
+
+  int i;
+
+  for( i = 0; i<CHUNKS.snaps; i++ )
+    if( c->epoch < CHUNKS.snapAt[i] && CHUNKS.snapAt[i] <= upto )
+      return true;
 
-  return BUFFER[row]->editP;
+  return false;
 }
 
-void setBufferRowEdited( int row, bool pred ) {
+/* Give Up a List, Keeping It If Held or While a Snapshot May Read It */
+static void _dropChunks( chunk_t *c ) {
+
+  if( c->heldP )
+    return;
 
-  BUFFER[row]->editP = pred;
+  c->diedAt = CHUNKS.epoch;
+
+  if( !_snapReadsP( c, c->diedAt ))
+    _freeChunks( c );
+  else
+    c->deadP = true;
 }
 
-int getBufferGapRightIndex( int row ) {
+/* Free Lists Given Up That No Snapshot Left Can Read */
+static void _sweepChunks( void ) {
+
+  int i;
 
-  return BUFFER[row]->rPtr;
+  for( i = CHUNKS.n - 1; i >= 0; i-- )
+    if( CHUNKS.list[i]->deadP && !_snapReadsP( CHUNKS.list[i], CHUNKS.list[i]->diedAt ))
+      _freeChunks( CHUNKS.list[i] );
 }
 
-int getBufferGapLeftIndex( int row ) {
+/* Free Every List and the Whole Line Copy */
+static void _releaseChunks( void ) {
+
+  while( CHUNKS.n > 0 )
+    _freeChunks( CHUNKS.list[ CHUNKS.n - 1 ] );
+
+  free( CHUNKS.list );
+  CHUNKS.list = NULL;
+  CHUNKS.max  = 0;
 
-  return BUFFER[row]->lPtr;
+  free( CHUNKS.snapAt );
+  CHUNKS.snapAt  = NULL;
+  CHUNKS.snaps   = 0;
+  CHUNKS.snapMax = 0;
+
+  free( FLAT.txt );
+  FLAT.txt   = NULL;
+  FLAT.size  = 0;
+  FLAT.stamp = 0;
 }
 
-int getBufferGapSize( int row ) {
-  
-  return BUFFER[row]->rPtr - BUFFER[row]->lPtr;
+/* Room for n More Chunks */
+static void _reserveChunks( chunk_t *c, int n ) {
+
+  if( c->n + n <= c->max )
+    return;
+
+  while( c->n + n > c->max )
+    c->max = c->max ? c->max * 2 : 16;
+
+  if(( c->piece = realloc( c->piece, c->max * sizeof( row_t ))) == NULL ||
+     ( c->at    = realloc( c->at,    c->max * sizeof( size_t ))) == NULL )
+    die( "_reserveChunks: realloc failed" );
 }
 
-void setBufferGapPtrs( int row, int left, int right ) {
+/* Open n Chunks Before Chunk i, for the Caller to Fill */
+static void _openChunks( chunk_t *c, int i, int n ) {
 
-  BUFFER[row]->lPtr = left;
-  BUFFER[row]->rPtr = right;
+  _reserveChunks( c, n );
+
+  memmove( c->piece + i + n, c->piece + i, ( c->n - i ) * sizeof( row_t ));
+  memmove( c->at + i + n, c->at + i, ( c->n - i ) * sizeof( size_t ));
+  c->n += n;
 }
 
-void increaseBufferGap( int row ) {
+/* Remove n Chunks From Chunk i */
+static void _closeChunks( chunk_t *c, int i, int n ) {
 
-  if( BUFFER[row]->rPtr < BUFFER[row]->len - 1 )
-    BUFFER[row]->rPtr++;
+  memmove( c->piece + i, c->piece + i + n, ( c->n - i - n ) * sizeof( row_t ));
+  memmove( c->at + i, c->at + i + n, ( c->n - i - n ) * sizeof( size_t ));
+  c->n -= n;
 }
 
-/*****************************************************************************************
-				   MODIFY BUFFER LINES
-*****************************************************************************************/
+/* Recount Columns From Chunk i On, After an Edit There */
+static void _recountChunks( chunk_t *c, int i ) {
 
-/* Free row_t */
-void freeBufferLine( int row ) {
+  size_t at = ( i > 0 ) ? c->at[i-1] + c->piece[i-1].len : 0;
 
-  int nRows = getBufferNumRows();
-  
-  free( BUFFER[row]->txt );
-  free( BUFFER[row] );
-    
-  for( int i=row; i<nRows-1; i++ ) {
+  for( ; i<c->n; i++ ) {
+    c->at[i] = at;
+    at += c->piece[i].len;
+  }
+
+  c->len   = at;
+  c->stamp = ++CHUNKS.stamp;
+}
+
+/* Chunk Holding Column col, the Last If col Is the End */
+static int _findChunk( const chunk_t *c, size_t col ) {
 
-    BUFFER[i] = BUFFER[i+1];
+  int lo = 0, hi = c->n - 1, mid;
+
+  while( lo < hi ) {
+    mid = ( lo + hi + 1 ) / 2;
+    if( c->at[mid] <= col ) lo = mid;
+    else hi = mid - 1;
   }
 
-  setBufferNumRows( --nRows );
+  return lo;
 }
 
+/* Split the Chunk Holding col There, Return the Chunk Starting at col */
+static int _cutChunks( chunk_t *c, size_t col ) {
 
-/*****************************************************************************************
-				    MANAGE KILL BUFFER
-*****************************************************************************************/
+  int i;
+  size_t k;
 
-/* Empty Kill Buffer */
-void emptyKillBuffer( void ) {
+  if( col >= c->len )
+    return c->n;
 
-  free( KILLBUFFER );
+  i = _findChunk( c, col );
+  k = col - c->at[i];
+
+  if( k == 0 )
+    return i;
+
+  _openChunks( c, i + 1, 1 );
+  c->piece[i+1]      = c->piece[i];
+  c->piece[i+1].off += k;
+  c->piece[i+1].len -= k;
+  c->at[i+1]         = col;
+  c->piece[i].len    = k;
+
+  return i + 1;
 }
 
-/* Remove /n from Kill Buffer */
-void _trimKillBuffer( void ) {
+/* Append n Bytes of r's Text From from to c, By Reference */
+static void _appendText( chunk_t *c, const row_t *r, size_t from, size_t n ) {
+
+  int i;
+  size_t k;
+  row_t p;
+  chunk_t *rc;
+
+  if( r->src == CHUNKTEXT ) {
+    rc = _chunkOf( r );
+    for( i = _findChunk( rc, from ); n > 0; i++ ) {
+      k = rc->at[i] + rc->piece[i].len - from;
+      if( k > n ) k = n;
+      _appendText( c, &rc->piece[i], from - rc->at[i], k );
+      from += k;
+      n    -= k;
+    }
+    return;
+  }
 
-  int sz = strlen( KILLBUFFER );
-  if( KILLBUFFER[sz-1] == '\n' ) {
-    KILLBUFFER[sz-1] = '\0';
-    sz--;
+  /* Inline Text Has No Home to Reference */
+  p = *r;
+  if( p.src == INLINETEXT ) {
+    p.off = arenaAppend( &ADDBUFFER, _rowText( r ) + from, n );
+    p.src = ADDTEXT;
   }
+  else
+    p.off += from;
 
-  KILLBUFFERLENGTH = sz;
+  for( ; n > 0; n -= p.len, p.off += p.len ) {
+    p.len = ( n < CHUNKMAX ) ? n : CHUNKMAX;
+    _reserveChunks( c, 1 );
+    c->piece[ c->n++ ] = p;
+  }
 }
 
-/* Get KILLBUFFER Pointer and Length */
-int getKillBufferLength( void ) {
+/* Row of n Bytes of r's Text From from, Chunked */
+static row_t _chunkText( const row_t *r, size_t from, size_t n ) {
 
-  return KILLBUFFERLENGTH;
-}
-char *getKillBufferPtr( void ) {
+  chunk_t *c = _newChunks();
+  row_t cr;
+
+  _appendText( c, r, from, n );
+  _recountChunks( c, 0 );
 
-  return KILLBUFFER;
+  cr.off = (uintptr_t)c;
+  cr.len = c->len;
+  cr.src = CHUNKTEXT;
+
+  return cr;
 }
 
-/* Delete Point (thisRow,thisCol) to End of Line */
-void freeBufferPointToEOL( int thisRow, int thisCol ) {
+/* List of r to Edit, Copied If Held or a Snapshot May Read It */
+static chunk_t *_ownChunks( row_t *r ) {
 
-  int size;
-  
-  /* Create Heap Space for New 'Trimmed' String */
-  char *tmp = malloc( sizeof( char ) * ( thisCol + 2 ));
-  if( thisCol > 0 )
-    strncpy( tmp, BUFFER[thisRow]->txt, thisCol );
-
-  /* Save Killed Text in Kill Buffer */
-  emptyKillBuffer();
-  size = BUFFER[thisRow]->len - thisCol;
-  KILLBUFFER = malloc( sizeof( char ) * size + 1 );
-  strncpy( KILLBUFFER, &(BUFFER[thisRow]->txt[thisCol]), size );
-  KILLBUFFER[size] = '\0';
-  _trimKillBuffer();
-
-  /* De-Allocate Heap Space for Old Buffer Line */
-  free( BUFFER[thisRow]->txt );
-
-  /* Fix Up Row_t For This ThisRow */
-  BUFFER[thisRow]->txt = tmp;
-  BUFFER[thisRow]->len = thisCol + 1;
-  BUFFER[thisRow]->txt[BUFFER[thisRow]->len-1] = '\n';
-  BUFFER[thisRow]->txt[BUFFER[thisRow]->len] = '\0';
+  chunk_t *c = _chunkOf( r );
+  chunk_t *own;
 
-  return;
+  /* No Snapshot Held Saw It */
+  if( !c->heldP && ( c->epoch == CHUNKS.epoch || !_snapReadsP( c, CHUNKS.epoch ))) {
+    c->epoch = CHUNKS.epoch;
+    return c;
+  }
+
+  own = _newChunks();
+  _reserveChunks( own, c->n );
+  memcpy( own->piece, c->piece, c->n * sizeof( row_t ));
+  memcpy( own->at, c->at, c->n * sizeof( size_t ));
+  own->n   = c->n;
+  own->len = c->len;
+
+  _dropChunks( c );
+  r->off = (uintptr_t)own;
+
+  return own;
 }
 
+/* Copy n Bytes of r's Text From from to dst */
+static void _copyRowText( const row_t *r, size_t from, size_t n, char *dst ) {
 
-/* Replace Text String in Buffer Line */
-void replaceBufferLineText( int row, int newLen, char *newTxt ) {
+  int i;
+  size_t k;
+  chunk_t *c;
 
-  free( BUFFER[row]->txt );
-  BUFFER[row]->txt  = newTxt;
-  BUFFER[row]->len  = newLen;
-  BUFFER[row]->lPtr = 0;
-  BUFFER[row]->rPtr = 0;
+  if( r->src != CHUNKTEXT ) {
+    memcpy( dst, _rowText( r ) + from, n );
+    return;
+  }
 
-  return;
+  c = _chunkOf( r );
+  for( i = _findChunk( c, from ); n > 0; i++ ) {
+    k = c->at[i] + c->piece[i].len - from;
+    if( k > n ) k = n;
+    memcpy( dst, _rowText( &c->piece[i] ) + ( from - c->at[i] ), k );
+    dst  += k;
+    from += k;
+    n    -= k;
+  }
 }
 
-/* Open a New Line */
-void openLine( void ) {
+/* Whole Text of a Chunked Row, Copied Once per Change */
+static char *_flatText( const row_t *r ) {
 
-  int PtY = getPointY();
-  int PtX = getPointX();
+  chunk_t *c = _chunkOf( r );
 
-  int thisRow = getRowOffset() + getPointY();
-  
-  /* Double Buffer, If Full */
-  if( bufferFullP() )
-    doubleBufferSize();
+  if( FLAT.stamp != c->stamp ) {
+    if( c->len > FLAT.size ) {
+      FLAT.size = c->len;
+      if(( FLAT.txt = realloc( FLAT.txt, FLAT.size )) == NULL )
+	die( "_flatText: realloc failed" );
+    }
+    _copyRowText( r, 0, c->len, FLAT.txt );
+    FLAT.stamp = c->stamp;
+  }
 
-  /* Move Lines Down */
-  int i;
+  return FLAT.txt;
+}
 
-  for( i=getBufferNumRows(); i>thisRow+1; i-- ) {
-    BUFFER[i] = BUFFER[i-1];
+/***
+    Replace Columns left to right of Chunked Row r With txt
+
+    An edit inside the private chunk at the end of the ADD buffer is
+    made in place.  Otherwise the columns are cut out and txt written
+    to the ADD buffer, joined with the chunks either side while that
+    keeps it within CHUNKMAX.
+***/
+static void _spliceChunks( row_t *r, size_t left, size_t right, const char *txt, size_t len ) {
+
+  chunk_t *c = _ownChunks( r );
+  row_t *p;
+  char *line;
+  int i, a, b;
+  size_t k, ll, rl, total, off;
+  bool useL, useR;
+
+  /* Chunk Holding the Edit, or Ending Where It Starts */
+  for( i = _findChunk( c, left ); i >= 0 && c->at[i] + c->piece[i].len >= left; i-- ) {
+
+    p = &c->piece[i];
+    k = p->len - ( right - left ) + len;
+
+    if( right > c->at[i] + p->len || !_rowAtAddTailP( p ) ||
+	k > CHUNKMAX || !arenaFitsP( &ADDBUFFER, p->off, k ))
+      continue;
+
+    line = arenaPtr( &ADDBUFFER, p->off );
+    memmove( line + ( left - c->at[i] ) + len, line + ( right - c->at[i] ),
+	     c->at[i] + p->len - right );
+    memcpy( line + ( left - c->at[i] ), txt, len );
+    p->len = k;
+    ADDBUFFER.used = p->off + k;
+
+    if( k == 0 )
+      _closeChunks( c, i, 1 );
+    _recountChunks( c, i );
+    r->len = c->len;
+    return;
   }
 
-  /* Create New Line */
-  BUFFER[i] = malloc( sizeof( row_t ));
-  BUFFER[i]->len = BUFFER[thisRow]->len - PtX;
-  BUFFER[i]->txt = malloc( sizeof( char ) * ( BUFFER[i]->len + 1 ));
-  BUFFER[i]->lPtr   = 0;
-  BUFFER[i]->rPtr   = 0;
-  BUFFER[i]->editP  = false;
+  /* Cut Out left to right */
+  a = _cutChunks( c, left );
+  b = _cutChunks( c, right );
+  _closeChunks( c, a, b - a );
 
+  /* Join txt With Small Neighbours */
+  ll = ( a > 0 )    ? c->piece[a-1].len : 0;
+  rl = ( a < c->n ) ? c->piece[a].len   : 0;
 
-  /* Copy Text Into New Line */
-  if( strncpy( BUFFER[i]->txt, 
-               BUFFER[thisRow]->txt + PtX,
-               BUFFER[i]->len ) == NULL ) die( "openLine: strncpy failed." );
+  useL = ( ll > 0 && rl > 0 && ll + len + rl <= CHUNKMAX );
+  useR = useL;
+  if( !useL && len > 0 ) {
+    useL = ( ll > 0 && ll + len <= CHUNKMAX );
+    useR = ( !useL && rl > 0 && len + rl <= CHUNKMAX );
+  }
 
-  BUFFER[i]->txt[BUFFER[i]->len] = '\0';
+  if( useL || useR ) {
 
+    total = ( useL ? ll : 0 ) + len + ( useR ? rl : 0 );
 
-  /* Heap Space for Trimmed String */
-  char *tmp = malloc( sizeof( char ) * ( PtX + 2 ));
-  if( PtX > 0 )
-    strncpy( tmp, BUFFER[thisRow]->txt, PtX );
-  free( BUFFER[thisRow]->txt );
+    if( useL && _rowAtAddTailP( &c->piece[a-1] ) &&
+	arenaFitsP( &ADDBUFFER, c->piece[a-1].off, total ))
+      off = c->piece[a-1].off;
+    else {
+      off = arenaReserve( &ADDBUFFER, total );
+      if( useL )
+	memcpy( arenaPtr( &ADDBUFFER, off ), _rowText( &c->piece[a-1] ), ll );
+    }
 
-  /* Fix Up row_t For This Row */
-  BUFFER[thisRow]->txt = tmp;
-  BUFFER[thisRow]->len = PtX + 1;
-  BUFFER[thisRow]->txt[BUFFER[thisRow]->len-1] = '\n';
-  BUFFER[thisRow]->txt[BUFFER[thisRow]->len] = '\0';
+    line = arenaPtr( &ADDBUFFER, off ) + ( useL ? ll : 0 );
+    memcpy( line, txt, len );
+    if( useR )
+      memcpy( line + len, _rowText( &c->piece[a] ), rl );
+    ADDBUFFER.used = off + total;
+
+    if( useL ) a--;
+    _closeChunks( c, a, useL + useR );
+    _openChunks( c, a, 1 );
+    c->piece[a].off = off;
+    c->piece[a].len = total;
+    c->piece[a].src = ADDTEXT;
+  }
 
-  clrtoeol();
-  
-  /* Move Point */
-  setPointX( 0 );
-  if( PtY == getScreenRows() )
-    setRowOffset( getRowOffset() + 1 );
-  else
-    setPointY( ++PtY );
+  /* Big Insert, Chunks of Its Own */
+  else if( len > 0 ) {
+
+    off = arenaAppend( &ADDBUFFER, txt, len );
+    b   = ( len + CHUNKMAX - 1 ) / CHUNKMAX;
+
+    _openChunks( c, a, b );
+    for( i = 0; i<b; i++ ) {
+      c->piece[a+i].off = off + (size_t)i * CHUNKMAX;
+      c->piece[a+i].len = ( len - (size_t)i * CHUNKMAX < CHUNKMAX ) ?
+	len - (size_t)i * CHUNKMAX : CHUNKMAX;
+      c->piece[a+i].src = ADDTEXT;
+    }
+  }
 
-  setBufferNumRows( getBufferNumRows() + 1 ); /* Increment Num Lines */
+  _recountChunks( c, a );
+  r->len = c->len;
 }
 
-/* Combine 'This' Text Line With Prior Text Line */
-void combineLineWithPrior( void ) {
+/* File Chunk Reading Past Offset from? */
+static bool _origPastP( const row_t *p, size_t from ) {
 
-  int thisRow = getRowOffset() + getPointY();
-  
-  if( thisRow == 0 )
+  return p->src == ORIGTEXT && p->off + p->len > from;
+}
+
+/* Copy the Chunks of r Reading File Text Past from to ADD Buffer */
+static void _privateChunks( row_t *r, size_t from ) {
+
+  chunk_t *c = _chunkOf( r );
+  int i;
+
+  for( i = 0; i<c->n && !_origPastP( &c->piece[i], from ); i++ )
+    ;
+  if( i == c->n )
     return;
 
-  char *tmp;				     /* New Text String */
-        
-  /* Allocate Memory for Combined String */
-  int preLineLen = BUFFER[thisRow-1]->len - 1;
-  int nxtLineLen = BUFFER[thisRow]->len;
-  int size       = preLineLen + nxtLineLen + 1;
-
-  if(( tmp = malloc( sizeof( char ) * size )) == NULL )
-    die( "BUFFER: tmp malloc failed" );
-
-  /* Copy Old/New Text Into New Line */
-  strncpy( tmp, 
-           BUFFER[thisRow-1]->txt,
-           preLineLen );
-  strncpy( tmp + preLineLen,
-           BUFFER[thisRow]->txt,
-           nxtLineLen );
-  BUFFER[thisRow-1]->len = size - 1;
-        
-  /* Free Old Memory and Set Pointer */
-  free( BUFFER[thisRow-1]->txt );
-  BUFFER[thisRow-1]->txt = tmp;
-
-  /* Destroy Next Line */
+  c = _ownChunks( r );
+  for( ; i<c->n; i++ ) {
+    if( _origPastP( &c->piece[i], from )) {
+      c->piece[i].off = _addText( ORIGBUFFER + c->piece[i].off, c->piece[i].len );
+      c->piece[i].src = ADDTEXT;
+    }
+  }
+}
+
+
+/*****************************************************************************************
+				    BUFFER SNAPSHOTS
+*****************************************************************************************/
+
+/***
+    Buffer Snapshot
+
+    Shares the line table copy on write and freezes the ADD text written
+    so far, so no row edits it in place.  The snapshot reads that text
+    through its own arena view, so another thread may walk it while
+    editing goes on.  Nothing is copied.
+***/
+struct _bufsnap {
+  lineSnap_t  lines;			     /* Snapshot Rows */
+  arena_t     text;			     /* View of Frozen ADD Text */
+  const char *orig;			     /* ORIGINAL Text */
+  unsigned long epoch;			     /* Chunk Epoch It Began */
+};
+
+/* Walk Callback and Its Argument */
+typedef struct {
+  bufferSnap_t *snap;
+  bool (*visit)( const char *, row_t, void * );
+  void *arg;
+} snapWalk_t;
+
+bufferSnap_t *snapBuffer( void ) {
+
+  bufferSnap_t *snap;
+
+  if(( snap = malloc( sizeof( bufferSnap_t ))) == NULL )
+    die( "snapBuffer: malloc failed" );
+
+  snap->lines = snapLineTable();
+  snap->text  = arenaView( &ADDBUFFER );
+  snap->orig  = ORIGBUFFER;
+  ADDFROZEN   = ADDBUFFER.used;
+
+  /* Chunk Lists Are Copied Before Their Next Edit */
+  if( CHUNKS.snaps == CHUNKS.snapMax ) {
+    CHUNKS.snapMax = CHUNKS.snapMax ? CHUNKS.snapMax * 2 : 8;
+    if(( CHUNKS.snapAt = realloc( CHUNKS.snapAt,
+				  CHUNKS.snapMax * sizeof( unsigned long ))) == NULL )
+      die( "snapBuffer: realloc failed" );
+  }
+  snap->epoch = ++CHUNKS.epoch;
+  CHUNKS.snapAt[ CHUNKS.snaps++ ] = snap->epoch;
+
+  return snap;
+}
+
+int getBufferSnapRows( bufferSnap_t *snap ) {
+
+  return snap->lines.rows;
+}
+
+/* Hand a Snapshot Row and Its Text to the Caller */
+static bool _visitSnapRow( row_t r, void *arg ) {
+
+  snapWalk_t *w = arg;
+  const char *txt;
+  chunk_t *c;
+  row_t p;
+  int i;
+
+  /* Chunk by Chunk, All But the Last Marked CHUNKTEXT */
+  if( r.src == CHUNKTEXT ) {
+    c = _chunkOf( &r );
+    for( i = 0; i<c->n; i++ ) {
+      p = c->piece[i];
+      if( p.src == ADDTEXT )
+	txt = arenaPtr( &w->snap->text, p.off );
+      else
+	txt = w->snap->orig + p.off;
+      if( i < c->n - 1 )
+	p.src = CHUNKTEXT;
+      if( !w->visit( txt, p, w->arg ))
+	return false;
+    }
+    return true;
+  }
+
+  if( r.src == INLINETEXT )
+    txt = (const char *)&r.off;
+  else if( r.src == ADDTEXT )
+    txt = arenaPtr( &w->snap->text, r.off );
+  else
+    txt = w->snap->orig + r.off;
+
+  return w->visit( txt, r, w->arg );
+}
+
+/***
+    Visit Rows From first Until visit Returns false
+
+    Inline text lasts one call.  A chunked row is visited a chunk at a
+    time; every chunk but its last comes with src CHUNKTEXT.
+***/
+bool walkBufferSnap( bufferSnap_t *snap, int first,
+		     bool (*visit)( const char *, row_t, void * ), void *arg ) {
+
+  snapWalk_t w = { snap, visit, arg };
+
+  return walkLineSnap( snap->lines, first, _visitSnapRow, &w );
+}
+
+void releaseBufferSnap( bufferSnap_t *snap ) {
+
+  int i;
+
+  for( i = 0; CHUNKS.snapAt[i] != snap->epoch; i++ )
+    ;
+  CHUNKS.snapAt[i] = CHUNKS.snapAt[ --CHUNKS.snaps ];
+
+  releaseLineSnap( snap->lines );
+  arenaRelease( &snap->text );
+  free( snap );
+
+  _sweepChunks();
+}
+
+
+/*****************************************************************************************
+				       ATOMIC SAVE
+*****************************************************************************************/
+
+/* Durability of Saves, From AE_FSYNC */
+enum _sync { SYNCNEVER, SYNCFILE, SYNCALL };
+
+static enum _sync _syncPolicy( void ) {
+
+  char *env = getenv( "AE_FSYNC" );
+
+  if( env && strcmp( env, "never" ) == 0 ) return SYNCNEVER;
+  if( env && strcmp( env, "file" )  == 0 ) return SYNCFILE;
+
+  return SYNCALL;			     /* File and Directory */
+}
+
+/* Write All of iov, Picking Up After Short Writes */
+static bool _writeAll( int fd, struct iovec *iov, int n ) {
+
+  ssize_t done;
+
+  while( n > 0 ) {
+
+    if(( done = writev( fd, iov, n )) == -1 ) {
+      if( errno == EINTR ) continue;
+      return false;
+    }
+
+    while( n > 0 && (size_t)done >= iov->iov_len ) {
+      done -= iov->iov_len;
+      iov++;
+      n--;
+    }
+
+    if( n > 0 ) {
+      iov->iov_base = (char *)iov->iov_base + done;
+      iov->iov_len -= done;
+    }
+  }
+
+  return true;
+}
+
+/* Sync the Directory Holding fn, So a Rename Survives a Crash */
+static void _syncDir( const char *fn ) {
+
+  int fd;
+  char *dir = strdup( fn );
+  char *slash;
+
+  if( dir == NULL )
+    die( "_syncDir: strdup failed" );
+
+  if(( slash = strrchr( dir, '/' )) == NULL )
+    strcpy( dir, "." );
+  else if( slash == dir )
+    dir[1] = '\0';
+  else
+    *slash = '\0';
+
+  if(( fd = open( dir, O_RDONLY )) != -1 ) {
+    fsync( fd );
+    close( fd );
+  }
+
+  free( dir );
+}
+
+/***
+    Background Save
+
+    A save snapshots the buffer and hands it to a writer thread, so
+    editing goes on while it runs.  The buffer only turns ORIGINAL if
+    nothing changed since the snapshot.
+***/
+static struct {
+  bool          activeP;		     /* Save Started, Not Yet Reported */
+  bool          threadP;		     /* Writer Thread Running */
+  pthread_t     thread;
+  char         *fn;			     /* File Being Written */
+  mode_t        mode;
+  enum _sync    sync;
+  bufferSnap_t *snap;			     /* Rows Being Written */
+  bool          inPlaceP;		     /* Rewrite fn From Byte from On */
+  off_t         from;
+  int           fromRow;
+  int           lowRow;			     /* LOWROW at Snapshot */
+  int           rows;
+  size_t        journal;		     /* Journal Length at Snapshot */
+  unsigned long gen;			     /* Buffer Version Saved */
+  unsigned long mods;
+
+  pthread_mutex_t lock;			     /* Guards the Fields Below */
+  int           rowsDone;		     /* Progress */
+  bool          doneP;
+  ssize_t       bytes;			     /* Result, -1 on Failure */
+  int           err;
+  double        secs;
+  struct stat   st;			     /* File as Written */
+} SAVE = { .activeP = false, .lock = PTHREAD_MUTEX_INITIALIZER };
+
+/* Rows Gathered for One writev */
+typedef struct {
+  int    fd;
+  int    n;				     /* iovec Entries Used */
+  int    rows;				     /* Rows Gathered So Far */
+  size_t staged;			     /* Inline Bytes Staged */
+  size_t batch;				     /* Bytes in This Batch */
+  size_t bytes;				     /* Bytes in All Batches */
+  struct iovec iov[ SAVEIOV ];
+  char   stage[ SAVEIOV * INLINEMAX ];
+} batch_t;
+
+/* Write Out a Batch and Post Progress */
+static bool _flushBatch( batch_t *b ) {
+
+  if( !_writeAll( b->fd, b->iov, b->n ))
+    return false;
+
+  b->n = 0;
+  b->staged = b->batch = 0;
+
+  pthread_mutex_lock( &SAVE.lock );
+  SAVE.rowsDone = b->rows;
+  pthread_mutex_unlock( &SAVE.lock );
+
+  return true;
+}
+
+/***
+    Add a Snapshot Row to the Batch
+
+    Rows whose text sits end to end in memory, as unedited file lines
+    do, share one iovec, so a clean file goes out in a few large writes.
+    Inline rows are staged since their text lives in the row.
+***/
+static bool _batchRow( const char *rowTxt, row_t r, void *arg ) {
+
+  batch_t *b = arg;
+  char *txt = (char *)rowTxt;
+
+  if( b->n == SAVEIOV || b->batch >= SAVEBATCH )
+    if( !_flushBatch( b ))
+      return false;
+
+  if( r.src == INLINETEXT ) {
+    txt = b->stage + b->staged;
+    memcpy( txt, rowTxt, r.len );
+    b->staged += r.len;
+  }
+
+  /* Extend Last Entry, or Start a New One */
+  if( b->n > 0 && (char *)b->iov[b->n-1].iov_base + b->iov[b->n-1].iov_len == txt )
+    b->iov[b->n-1].iov_len += r.len;
+  else {
+    b->iov[b->n].iov_base = txt;
+    b->iov[b->n].iov_len  = r.len;
+    b->n++;
+  }
+
+  if( r.src != CHUNKTEXT )		     /* Row Ends Here */
+    b->rows++;
+  b->batch += r.len;
+  b->bytes += r.len;
+
+  return true;
+}
+
+/* Write Snapshot Rows From SAVE.fromRow On to fd */
+static bool _writeRows( int fd, size_t *bytes ) {
+
+  batch_t *b;
+  bool okP;
+
+  if(( b = malloc( sizeof( batch_t ))) == NULL )
+    die( "_writeRows: malloc failed" );
+
+  b->fd = fd;
+  b->n  = b->rows = 0;
+  b->staged = b->batch = b->bytes = 0;
+
+  okP = walkBufferSnap( SAVE.snap, SAVE.fromRow, _batchRow, b ) && _flushBatch( b );
+  *bytes = b->bytes;
+
+  free( b );
+  return okP;
+}
+
+/***
+    Write the Snapshot to SAVE.fn
+
+    The text goes to a temporary file beside it, which is synced as
+    AE_FSYNC asks and renamed over it.  A crash mid save leaves the old
+    file whole, and the mapped old file stays valid for unedited rows.
+    Returns bytes written, or -1 with errno set.
+***/
+static ssize_t _saveAs( void ) {
+
+  int fd, err;
+  size_t bytes;
+  char *tmp;
+
+  if(( tmp = malloc( strlen( SAVE.fn ) + 10 )) == NULL )
+    die( "_saveAs: malloc failed" );
+  sprintf( tmp, "%s.aeXXXXXX", SAVE.fn );
+
+  if(( fd = mkstemp( tmp )) == -1 ) {
+    err = errno;
+    free( tmp );
+    errno = err;
+    return -1;
+  }
+
+  if( fchmod( fd, SAVE.mode & 07777 ) == -1                 ||
+      !_writeRows( fd, &bytes )                             ||
+      ( SAVE.sync != SYNCNEVER && fsync( fd ) == -1 )       ||
+      fstat( fd, &SAVE.st ) == -1                           ||
+      close( fd ) == -1                                     ||
+      rename( tmp, SAVE.fn ) == -1 ) {
+
+    err = errno;
+    close( fd );
+    unlink( tmp );
+    free( tmp );
+    errno = err;
+    return -1;
+  }
+
+  if( SAVE.sync == SYNCALL )
+    _syncDir( SAVE.fn );
+
+  /* A Save Journal Left by an Interrupted Rewrite is Done With */
+  closeSaveJournal( SAVE.fn );
+
+  free( tmp );
+  return (ssize_t)bytes;
+}
+
+/***
+    Rewrite SAVE.fn From Byte SAVE.from On
+
+    Not atomic: a crash mid save leaves the tail half written, so the
+    rows written are first journaled to FILE.aej.save and synced, and
+    opening the file again offers to finish the save from it.  Kept for
+    saves that only rewrite a small tail.  Returns bytes written, or -1
+    with errno set.
+***/
+static ssize_t _saveInPlace( void ) {
+
+  int fd, err;
+  size_t bytes;
+
+  if( !openSaveJournal( SAVE.fn, SAVE.from, SAVE.snap, SAVE.fromRow ))
+    return -1;
+
+  /* Nothing Written Yet, the File is Still Whole */
+  if(( fd = open( SAVE.fn, O_WRONLY )) == -1 ) {
+    err = errno;
+    closeSaveJournal( SAVE.fn );
+    errno = err;
+    return -1;
+  }
+
+  if( lseek( fd, SAVE.from, SEEK_SET ) == -1                ||
+      !_writeRows( fd, &bytes )                             ||
+      ftruncate( fd, SAVE.from + bytes ) == -1              ||
+      ( SAVE.sync != SYNCNEVER && fsync( fd ) == -1 )       ||
+      fstat( fd, &SAVE.st ) == -1 ) {
+
+    err = errno;
+    close( fd );
+    errno = err;
+    return -1;
+  }
+
+  if( close( fd ) == -1 )
+    return -1;
+
+  closeSaveJournal( SAVE.fn );
+  return (ssize_t)bytes;
+}
+
+/* Seconds on the Monotonic Clock */
+static double _now( void ) {
+
+  struct timespec ts;
+
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Writer Thread Body */
+static void *_saveWriter( void *arg ) {
+
+  double t0 = _now();
+  ssize_t bytes = SAVE.inPlaceP ? _saveInPlace() : _saveAs();
+  int err = errno;
+
+  (void)arg;
+
+  pthread_mutex_lock( &SAVE.lock );
+  SAVE.bytes = bytes;
+  SAVE.err   = err;
+  SAVE.secs  = _now() - t0;
+  SAVE.doneP = true;
+  pthread_mutex_unlock( &SAVE.lock );
+
+  return NULL;
+}
+
+/* Minibuffer Message, Leaving the Cursor at Point */
+static void _saveMessage( const char *msg ) {
+
+  int y, x;
+
+  getyx( stdscr, y, x );
+  miniBufferMessage( msg );
+  move( y, x );
+  refresh();
+}
+
+/* Join the Writer, Drop the Snapshot and Report */
+static void _endSave( void ) {
+
+  char msgBuffer[ 128 ];
+
+  if( SAVE.threadP )
+    pthread_join( SAVE.thread, NULL );
+
+  releaseBufferSnap( SAVE.snap );
+  SAVE.activeP = SAVE.threadP = false;
+
+  if( SAVE.bytes == -1 ) {
+    snprintf( msgBuffer, 128, "Save failed: %s", strerror( SAVE.err ));
+
+    /* Still Unsaved, and a Failed Rewrite Leaves the File Unknown */
+    if( SAVE.lowRow < LOWROW )
+      LOWROW = SAVE.lowRow;
+    if( SAVE.inPlaceP )
+      DISKFILE.knownP = false;
+  }
+
+  else {
+
+    DISKFILE.knownP = true;
+    DISKFILE.dev    = SAVE.st.st_dev;
+    DISKFILE.ino    = SAVE.st.st_ino;
+    DISKFILE.size   = SAVE.st.st_size;
+    DISKFILE.mtime  = SAVE.st.st_mtim;
+
+    /* Later Edits Now Apply to the Saved File */
+    rebaseJournal( SAVE.fn, SAVE.journal );
+
+    /* Only the Version on Disk is ORIGINAL */
+    if( SAVE.gen == BUFFERGEN && SAVE.mods == getStatusFlagModifications() )
+      setStatusFlagOriginal();
+
+    if( SAVE.bytes >= BIGFILE && SAVE.secs > 0 )
+      snprintf( msgBuffer, 128, "Wrote %d lines to %s (%.0f MB/s)", SAVE.rows,
+		SAVE.fn, SAVE.bytes / SAVE.secs / ( 1 << 20 ));
+    else if( SAVE.inPlaceP )
+      snprintf( msgBuffer, 128, "Wrote %d lines to %s from line %d", SAVE.rows,
+		SAVE.fn, SAVE.fromRow + 1 );
+    else
+      snprintf( msgBuffer, 128, "Wrote %d lines to %s", SAVE.rows, SAVE.fn );
+  }
+
+  free( SAVE.fn );
+  SAVE.fn = NULL;
+
+  _saveMessage( msgBuffer );
+}
+
+/* Byte Offset of row in the Saved File, Rows Before It Unchanged */
+static off_t _savedOffset( int row ) {
+
+  int i = ( row < BASEROW ) ? row : BASEROW;
+  off_t off = 0;
+  row_t r;
+
+  /* File Lines Are End to End */
+  if( i > 0 ) {
+    r   = _row( i-1 );
+    off = r.off + r.len;
+  }
+
+  for( ; i<row; i++ )
+    off += _row( i ).len;
+
+  return off;
+}
+
+/* Copy a Row Held for Undo or a Kill Out of File Text an In-Place Save Rewrites */
+static void _privateHeldRow( row_t *r ) {
+
+  if( r->src == ORIGTEXT && (off_t)( r->off + r->len ) > SAVE.from ) {
+    r->off = _addText( ORIGBUFFER + r->off, r->len );
+    r->src = ADDTEXT;
+    ADDFROZEN = ADDBUFFER.used;
+  }
+
+  /* Just Those Chunks, in a List of Its Own */
+  else if( r->src == CHUNKTEXT ) {
+    _privateChunks( r, SAVE.from );
+    _holdRowText( r );
+    ADDFROZEN = ADDBUFFER.used;
+  }
+}
+
+/***
+    Plan a Save of fn in Place
+
+    Only when fn is still the file last read or saved, its unchanged
+    head covers at least INPLACEMIN of it, and AE_FSYNC does not ask
+    for the atomic rename's durability.  If fn is also the mapped
+    file, the tail rows still reading it are copied out first, as the
+    rewrite would change them underfoot, as are rows held for undo and
+    the kill ring.
+***/
+static void _planInPlace( const struct stat *sb ) {
+
+  int row;
+  row_t r;
+  int low = ( LOWROW < getBufferNumRows() ) ? LOWROW : getBufferNumRows();
+
+  SAVE.inPlaceP = false;
+  SAVE.from     = 0;
+  SAVE.fromRow  = 0;
+
+  if( SAVE.sync == SYNCALL                     ||
+      !DISKFILE.knownP || low == 0            ||
+      sb->st_dev  != DISKFILE.dev             ||
+      sb->st_ino  != DISKFILE.ino             ||
+      sb->st_size != DISKFILE.size            ||
+      sb->st_mtim.tv_sec  != DISKFILE.mtime.tv_sec  ||
+      sb->st_mtim.tv_nsec != DISKFILE.mtime.tv_nsec )
+    return;
+
+  SAVE.from = _savedOffset( low );
+
+  if( SAVE.from > DISKFILE.size || SAVE.from < DISKFILE.size * INPLACEMIN ) {
+    SAVE.from = 0;
+    return;
+  }
+
+  if( ORIGMAPPEDP && sb->st_dev == ORIGDEV && sb->st_ino == ORIGINO ) {
+    for( row = low; row<getBufferNumRows(); row++ ) {
+      r = _row( row );
+      if( r.src == ORIGTEXT ) {
+	r.off = _addText( ORIGBUFFER + r.off, r.len );
+	r.src = ADDTEXT;
+	setLineTableRow( row, r );
+      }
+      else if( r.src == CHUNKTEXT ) {
+	_privateChunks( &r, SAVE.from );
+	setLineTableRow( row, r );
+      }
+    }
+    walkUndoRows( _privateHeldRow );
+    _privateKills();
+    BASEROW = low;
+  }
+
+  SAVE.inPlaceP = true;
+  SAVE.fromRow  = low;
+}
+
+/* Snapshot the Buffer and Start Writing It to fn */
+static void _startSave( const char *fn ) {
+
+  struct stat sb;
+  mode_t mask;
+
+  /* One Save at a Time */
+  finishBufferSave();
+
+  if(( SAVE.fn = strdup( fn )) == NULL )
+    die( "_startSave: strdup failed" );
+
+  /* Keep Mode of Existing File, Else Honor umask */
+  SAVE.sync     = _syncPolicy();
+  SAVE.inPlaceP = false;
+  SAVE.fromRow  = 0;
+  if( stat( fn, &sb ) == 0 ) {
+    SAVE.mode = sb.st_mode;
+    _planInPlace( &sb );
+  }
+  else {
+    mask = umask( 0 );
+    umask( mask );
+    SAVE.mode = 0666 & ~mask;
+  }
+
+  SAVE.snap    = snapBuffer();
+  SAVE.rows    = getBufferSnapRows( SAVE.snap ) - SAVE.fromRow;
+  SAVE.journal = markJournal();
+  SAVE.lowRow  = LOWROW;
+  LOWROW       = INT_MAX;
+
+  SAVE.gen   = BUFFERGEN;
+  SAVE.mods  = getStatusFlagModifications();
+
+  SAVE.rowsDone = 0;
+  SAVE.doneP    = false;
+  SAVE.activeP  = true;
+
+  /* Save in the Foreground If No Thread */
+  SAVE.threadP = ( pthread_create( &SAVE.thread, NULL, _saveWriter, NULL ) == 0 );
+  if( !SAVE.threadP )
+    _saveWriter( NULL );
+}
+
+/* Report Save Progress, Finishing a Save Once the Writer is Done */
+void pollBufferSave( void ) {
+
+  char msgBuffer[ 128 ];
+  bool doneP;
+  int rows;
+
+  if( !SAVE.activeP )
+    return;
+
+  pthread_mutex_lock( &SAVE.lock );
+  doneP = SAVE.doneP;
+  rows  = SAVE.rowsDone;
+  pthread_mutex_unlock( &SAVE.lock );
+
+  if( doneP ) {
+    _endSave();
+    return;
+  }
+
+  snprintf( msgBuffer, 128, "Saving %s ... %d%%", SAVE.fn,
+	    SAVE.rows ? (int)( 100.0 * rows / SAVE.rows ) : 0 );
+  _saveMessage( msgBuffer );
+}
+
+/* Wait For a Save in Progress */
+void finishBufferSave( void ) {
+
+  if( SAVE.activeP )
+    _endSave();
+}
+
+
+/*****************************************************************************************
+				      MEMORY BUDGET
+*****************************************************************************************/
+
+/***
+    Keeping a Large Buffer Within the Memory Budget
+
+    Unedited rows are text in the mapped file, so their pages can be
+    dropped and read back from disk.  Edited text and line table nodes
+    past the budget live in the spill file (see arena.c).  While the
+    editor waits for keys, and the buffer is bigger than the budget,
+    the file pages and the older spilled blocks are handed back to the
+    kernel every TRIMSECS.  Rows on the screen fault back in as they
+    are drawn.
+
+    Line table leaves more than HOTROWS from the screen are packed at
+    the same time, whatever the budget.
+***/
+void trimBufferMemory( void ) {
+
+  static double last = 0.0;
+
+  double now = _now();
+
+  if( now - last < TRIMSECS ) return;
+  last = now;
+
+  if( !fileViewP() )
+    packLineTable( getRowOffset() - HOTROWS,
+		   getRowOffset() + getWinNumRows() + HOTROWS );
+
+  if( ORIGLENGTH + getHeapBlockBytes() + getSpillBytes() <= getMemoryBudget() )
+    return;
+
+  if( ORIGMAPPEDP )
+    dropResidentPages( ORIGBUFFER, ORIGLENGTH );
+
+  trimSpill();
+}
+
+/* Show Where the Buffer's Memory Goes */
+void reportBufferMemory( void ) {
+
+  char msgBuffer[ 256 ];
+  lineMem_t m;
+
+  const double MB = 1024.0 * 1024.0;
+
+  getLineTableMemory( &m );
+
+  snprintf( msgBuffer, sizeof( msgBuffer ),
+	    "Leaves %zu %.1fM, packed %zu %.1fM %.1f:1 %.1fus/decode; "
+	    "heap %.1fM spill %.1fM of %.0fM",
+	    m.leaves, m.slabBytes / MB, m.packed, m.packedBytes / MB,
+	    m.packedBytes ? (double)m.fullBytes / m.packedBytes : 0.0,
+	    m.decodes ? m.decodeSecs * 1e6 / m.decodes : 0.0,
+	    getHeapBlockBytes() / MB, getSpillBytes() / MB, getMemoryBudget() / MB );
+
+  if( _internP() )
+    snprintf( msgBuffer + strlen( msgBuffer ), sizeof( msgBuffer ) - strlen( msgBuffer ),
+	      "; interned %zu %.1fM", INTERN.hits, INTERN.bytes / MB );
+
+  if( getUndoBytes() > 0 )
+    snprintf( msgBuffer + strlen( msgBuffer ), sizeof( msgBuffer ) - strlen( msgBuffer ),
+	      "; undo %.1fM", getUndoBytes() / MB );
+
+  miniBufferMessage( msgBuffer );
+}
+
+/*****************************************************************************************
+				    BUFFER MANAGEMENT
+ *****************************************************************************************/
+
+/* Setup Buffer Data Structure */
+void initializeBuffer( void ) {
+
+  /* Create Empty Line Table */
+  initializeLineTable();
+}
+
+
+/* Open AE on an Empty Buffer */
+void openEmptyBuffer( enum _bn bn ) {
+
+  setBufferNumRows( 0 );
+  row_t r;
+
+  _setInlineText( &r, "\n", 1 );
+  appendLineTableRow( r );
+  BUFFERGEN++;
+
+  /* Nothing on Disk Yet */
+  BASEROW = LOWROW = 0;
+  DISKFILE.knownP  = false;
+
+  if( bn == DEFAULT ) {
+    setDefaultFilename();
+    openJournal( getBufferFilename() );
+    openUndo();
+  }
+}
+
+/* File Too Big to Index in Memory? */
+static bool _viewSizeP( off_t size ) {
+
+  long pages    = sysconf( _SC_PHYS_PAGES );
+  long pageSize = sysconf( _SC_PAGESIZE );
+
+  return ( pages > 0 && pageSize > 0 &&
+	   (double)size >= (double)pages * pageSize * VIEWMIN );
+}
+
+/* Open fn in Read-Only View Mode */
+static bool _viewFile( char *fn ) {
+
+  char msgBuffer[ 128 ];
+
+  if( !openFileView( fn ))
+    return false;
+
+  /* Nothing to Journal or Save */
+  closeJournal();
+  DISKFILE.knownP = false;
+  BUFFERGEN++;
+  setStatusFlagReadOnly();
+
+  snprintf( msgBuffer, 128, "Viewing %d lines read-only", getBufferNumRows() );
+  miniBufferMessage( msgBuffer );
+
+  return true;
+}
+
+/* View A Text File Without Reading It Into Memory */
+void viewBufferFile( char *fn ) {
+
+  if( !_viewFile( fn ))
+    readBufferFile( fn );
+}
+
+/* Read A Text File from Disk */
+void readBufferFile( char * fn ) {
+
+  int fd;
+  struct stat sb;
+
+  /* Nothing to Undo Until the File is Read */
+  closeUndo();
+  
+  /* Check to See if File Exists and Readable */
+  if( access( fn, R_OK | F_OK ) == -1 ) {
+
+    miniBufferMessage( "Filename doesn't exist. Creating buffer for new file." );
+    openEmptyBuffer( UNAMED );
+    openJournal( fn );
+    openUndo();
+    return;
+  }
+  
+  /* Open File for Editing */
+  if(( fd = open( fn, O_RDONLY )) == -1 ) {
+    die( "openBuffer: open failed." );
+  }
+
+  if( fstat( fd, &sb ) == -1 ) {
+    die( "openBuffer: fstat failed." );
+  }
+
+  /* Larger Than Memory, View It Instead */
+  if( _viewSizeP( sb.st_size ) && _viewFile( fn )) {
+    close( fd );
+    return;
+  }
+
+  /* Map File Into ORIGINAL Buffer */
+  _freeOriginalText();
+  _loadOriginalText( fd, (size_t)sb.st_size );
+  close( fd );
+
+  /* Index Text Rows */
+  if( ORIGMAPPEDP )
+    posix_madvise( ORIGBUFFER, ORIGLENGTH, POSIX_MADV_SEQUENTIAL );
+
+  setBufferNumRows( 0 );
+  _indexLines( fn, &sb );
+
+  /* Every Row is File Text, Unchanged */
+  BASEROW = getBufferNumRows();
+  LOWROW  = INT_MAX;
+  ORIGDEV = sb.st_dev;
+  ORIGINO = sb.st_ino;
+
+  DISKFILE.knownP = true;
+  DISKFILE.dev    = sb.st_dev;
+  DISKFILE.ino    = sb.st_ino;
+  DISKFILE.size   = sb.st_size;
+  DISKFILE.mtime  = sb.st_mtim;
+
+  if( ORIGMAPPEDP )
+    posix_madvise( ORIGBUFFER, ORIGLENGTH, POSIX_MADV_NORMAL );
+
+  /* Report Indexing Speed for Big Files */
+  if( ORIGLENGTH >= BIGFILE ) {
+    char msgBuffer[ 128 ];
+    double secs = getLineCacheSeconds();
+
+    if( getLineCacheReused() > 0 )
+      snprintf( msgBuffer, 128, "Indexed %d lines in %.2f s from cache (%.1f MB rescanned)",
+		getBufferNumRows(), secs,
+		( ORIGLENGTH - getLineCacheReused()) / (double)( 1 << 20 ));
+    else
+      snprintf( msgBuffer, 128, "Indexed %d lines in %.2f s (%.0f lines/s, %d threads)",
+		getBufferNumRows(), secs, secs > 0 ? getBufferNumRows() / secs : 0.0,
+		getLineScanThreads() );
+    miniBufferMessage( msgBuffer );
+  }
+
+  if( getBufferNumRows() == 0 )		     /* Empty File */
+    openEmptyBuffer( UNAMED );
+
+  /* Offer Edits a Crash Left in the Journal */
+  openJournal( fn );
+  openUndo();
+}
+
+
+/* Save Buffer Lines */
+void saveBuffer() {
+
+  _startSave( getBufferFilename() );
+}
+
+
+/* Save Buffer Lines */
+void saveBufferNewName( void ) {
+
+  /* Get Filename to Write */
+  miniBufferGetFilename();
+
+  _startSave( getBufferFilename() );
+}
+
+
+/* Close Text Buffer */
+void closeBuffer( void ) {
+
+  /* Writer Reads the Text Buffers */
+  finishBufferSave();
+  closeJournal();
+  closeUndo();
+  emptyKillRing();
+
+  /* Release Line Table and Text Buffers */
+  freeLineTable();
+  BUFFERGEN++;
+
+  _freeOriginalText();
+
+  arenaRelease( &ADDBUFFER );
+  ADDFROZEN = 0;
+  _freeIntern();
+  _releaseChunks();
+
+  DISKFILE.knownP = false;
+  closeFileView();
+
+  EDITROW.row   = -1;
+  EDITROW.editP = false;
+
+  setPointX( 0 );
+  setPointY( 0 );
+  setMarkX( -1 );
+  setMarkY( -1 );
+  setRowOffset( 0 );
+  setColOffset( 0 );
+  setEditBufferIndex( 0 );
+  setRegionActive( false );
+  setStatusFlagOriginal();
+
+  clear();
+}
+
+/***
+    Close Current Buffer 
+    and Open Empty Buffer
+ ***/
+
+void killBuffer( void ) {
+
+  closeBuffer();
+
+  initializeBuffer();
+  
+  openEmptyBuffer( DEFAULT );
+  
+  clear();
+}
+
+/*****************************************************************************************
+				    BUFFER PROPERTIES
+*****************************************************************************************/
+int getBufferLineLen( int row ) {
+
+  if( fileViewP() )
+    return getFileViewLineLen( row );
+
+  return _row( row ).len;
+}
+
+/* Bytes of Text in the Buffer */
+size_t getBufferBytes( void ) {
+
+  if( fileViewP() )
+    return (size_t)getFileViewSize();
+
+  return getLineTableBytes();
+}
+
+/* Buffer Offset of Byte col in row */
+size_t getBufferOffset( int row, int col ) {
+
+  if( fileViewP() )
+    return (size_t)getFileViewOffset( row ) + col;
+
+  return getLineTableOffset( row ) + col;
+}
+
+/* Row Holding Buffer Byte *off, Which Becomes Its Column */
+int findBufferByte( size_t *off ) {
+
+  int row;
+
+  if( fileViewP() ) {
+    off_t o = (off_t)*off;
+
+    row  = findFileViewByte( &o );
+    *off = (size_t)o;
+    return row;
+  }
+
+  uint64_t o = *off;
+
+  row  = findLineTableByte( &o );
+  *off = o;
+  return row;
+}
+
+char getBufferChar( int row, int col ) {
+
+  if( fileViewP() )
+    return getFileViewLine( row )[ col ];
+
+  row_t r = _row( row );
+  chunk_t *c;
+  int i;
+
+  if( r.src == CHUNKTEXT ) {
+    c = _chunkOf( &r );
+    i = _findChunk( c, col );
+    return _rowText( &c->piece[i] )[ col - c->at[i] ];
+  }
+
+  return _rowText( &r )[ col ];
+}
+void setBufferChar( int row, int col, char c ) {
+
+  spliceBufferLineText( row, col, col+1, &c, 1 );
+}
+
+/* Changes When Any Row Text or the Row Count Changes */
+unsigned long getBufferGeneration( void ) {
+
+  return BUFFERGEN;
+}
+
+/* Row Text is NOT NULL Terminated, See getBufferLineLen; Short Lines
+   Are Copied Out, So the Pointer Only Lasts Until the Next Call */
+char *getBufferTextLine( int row ) {
+
+  if( fileViewP() )
+    return (char *)getFileViewLine( row );
+
+  TEXTROW = _row( row );
+
+  return _rowText( &TEXTROW );
+}
+
+/* Text of row From col On, *len Bytes of It Contiguous; Long Lines
+   Are Read a Span at a Time, Short Ones Last Until the Next Call */
+char *getBufferTextSpan( int row, int col, int *len ) {
+
+  chunk_t *c;
+  int i;
+
+  if( fileViewP() ) {
+    *len = getFileViewLineLen( row ) - col;
+    return (char *)getFileViewLine( row ) + col;
+  }
+
+  TEXTROW = _row( row );
+
+  if( TEXTROW.src != CHUNKTEXT ) {
+    *len = TEXTROW.len - col;
+    return _rowText( &TEXTROW ) + col;
+  }
+
+  c = _chunkOf( &TEXTROW );
+  i = _findChunk( c, col );
+  *len = c->at[i] + c->piece[i].len - col;
+
+  return _rowText( &c->piece[i] ) + ( col - c->at[i] );
+}
+
+/* Read Ahead the Text of rows Rows From row */
+void prefetchBufferRows( int row, int rows ) {
+
+  if( fileViewP() )
+    prefetchFileView( row, rows );
+}
+
+bool bufferLineModifiedP( int row ) {
+
+  return ( row == EDITROW.row && EDITROW.lPtr != EDITROW.rPtr );
+}
+
+bool bufferRowEditedP( int row ) {
+
+  return ( row == EDITROW.row && EDITROW.editP );
+}
+
+/* Make row the Active Edit Row */
+static void _editRow( int row ) {
+
+  if( row != EDITROW.row ) {
+    EDITROW.row   = row;
+    EDITROW.lPtr  = 0;
+    EDITROW.rPtr  = 0;
+    EDITROW.editP = false;
+  }
+}
+
+void setBufferRowEdited( int row, bool pred ) {
+
+  if( pred )
+    _editRow( row );
+
+  if( row == EDITROW.row )
+    EDITROW.editP = pred;
+}
+
+int getBufferGapRightIndex( int row ) {
+
+  return ( row == EDITROW.row ) ? EDITROW.rPtr : 0;
+}
+
+int getBufferGapLeftIndex( int row ) {
+
+  return ( row == EDITROW.row ) ? EDITROW.lPtr : 0;
+}
+
+int getBufferGapSize( int row ) {
+
+  return getBufferGapRightIndex( row ) - getBufferGapLeftIndex( row );
+}
+
+void setBufferGapPtrs( int row, int left, int right ) {
+
+  _editRow( row );
+
+  EDITROW.lPtr = left;
+  EDITROW.rPtr = right;
+}
+
+void increaseBufferGap( int row ) {
+
+  _editRow( row );
+
+  if( EDITROW.rPtr < getBufferLineLen( row ) - 1 )
+    EDITROW.rPtr++;
+}
+
+/* Keep Active Edit Row in Step With Inserted (count > 0) or Deleted Rows */
+static void _shiftEditRow( int row, int count ) {
+
+  if( EDITROW.row < row )
+    return;
+
+  if( count < 0 && EDITROW.row < row - count ) {
+    EDITROW.row   = -1;
+    EDITROW.editP = false;
+  }
+  else
+    EDITROW.row += count;
+}
+
+/*****************************************************************************************
+				   MODIFY BUFFER LINES
+*****************************************************************************************/
+
+/* Free row_t */
+void freeBufferLine( int row ) {
+
+  /* Line Text Stays in Its Buffer Until closeBuffer */
+  undoDeleteRows( row, 1 );
+  deleteLineTableRows( row, 1 );
+  BUFFERGEN++;
+  _changedRow( row );
+  journalDeleteRows( row, 1 );
+  _shiftEditRow( row, -1 );
+}
+
+/* Free count Rows Starting at row */
+void freeBufferLines( int row, int count ) {
+
+  undoDeleteRows( row, count );
+  deleteLineTableRows( row, count );
+  BUFFERGEN++;
+  _changedRow( row );
+  journalDeleteRows( row, count );
+  _shiftEditRow( row, -count );
+}
+
+/* Delete the Text From (row,col) Up to (endRow,endCol), in One Range */
+void freeBufferText( int row, int col, int endRow, int endCol ) {
+
+  row_t r;
+  char *rest;
+
+  if( endRow == row ) {
+    spliceBufferLineText( row, col, endCol, "", 0 );
+    return;
+  }
+
+  /* Rest of the Last Line Joins the First */
+  r = _row( endRow );
+  if(( rest = malloc( r.len - endCol + 1 )) == NULL )
+    die( "freeBufferText: malloc failed" );
+  _copyRowText( &r, endCol, r.len - endCol, rest );
+
+  freeBufferLines( row + 1, endRow - row );
+  spliceBufferLineText( row, col, getBufferLineLen( row ), rest, r.len - endCol );
+  free( rest );
+}
+
+/* Insert a Line Holding a Copy of txt Before row */
+void insertBufferLine( int row, const char *txt, int len ) {
+
+  row_t r;
+
+  if( len <= (int)INLINEMAX )
+    _setInlineText( &r, txt, len );
+  else {
+    r.src = ADDTEXT;
+    r.off = _addText( txt, len );
+    r.len = len;
+  }
+
+  insertLineTableRow( row, r );
+  BUFFERGEN++;
+  _changedRow( row );
+  journalInsertRow( row, txt, len );
+  undoInsertRows( row, 1 );
+  _shiftEditRow( row, 1 );
+}
+
+/* Row of the n Bytes of r From from, Short Text Copied, Long Shared */
+static row_t _partRow( const row_t *r, size_t from, size_t n ) {
+
+  row_t part = { r->off + from, n, r->src };
+  char tmp[INLINEMAX];
+
+  if( n <= INLINEMAX || r->src == INLINETEXT ) {
+    _copyRowText( r, from, n, tmp );
+    _setInlineText( &part, tmp, n );
+  }
+  else if( r->src == CHUNKTEXT )
+    part = _chunkText( r, from, n );
+
+  return part;
+}
+
+/* Keep r's Text as It Is, true If It Reads the ADD Buffer */
+static bool _holdRowText( const row_t *r ) {
+
+  if( r->src == CHUNKTEXT ) {
+    _chunkOf( r )->heldP = true;
+    return true;
+  }
+
+  return r->src == ADDTEXT;
+}
+
+/***
+    Copy n Rows From row to dst, For Undo
+
+    A row holds its text by reference, so its descriptor is enough to
+    put the line back.  A chunked line's list is held, so edits copy it
+    first, and the ADD text held is frozen so no later edit rewrites it
+    in place.
+***/
+void holdBufferRows( int row, int n, row_t *dst ) {
+
+  bool addP = false;
+  int i;
+
+  for( i = 0; i<n; i++ ) {
+    dst[i] = _row( row + i );
+    if( _holdRowText( &dst[i] ))
+      addP = true;
+  }
+
+  if( addP )
+    ADDFROZEN = ADDBUFFER.used;
+}
+
+/* Insert n Rows Before row, Text They Reference Already in Place */
+static void _insertRows( int row, const row_t *rows, int n ) {
+
+  row_t r;
+  int i;
+
+  insertLineTableRows( row, rows, n );
+  BUFFERGEN++;
+  _changedRow( row );
+
+  for( i = 0; i<n; i++ ) {
+    r = rows[i];
+    journalInsertRow( row + i, _rowText( &r ), r.len );
+  }
+
+  undoInsertRows( row, n );
+  _shiftEditRow( row, n );
+}
+
+/* Insert n Rows Held by holdBufferRows Before row */
+void restoreBufferRows( int row, const row_t *rows, int n ) {
+
+  _insertRows( row, rows, n );
+}
+
+/* Append the File Lines in len Bytes From off, false If Not in the File */
+bool appendBufferFileRows( size_t off, size_t len ) {
+
+  char *nl;
+  size_t n;
+
+  if( off > ORIGLENGTH || len > ORIGLENGTH - off )
+    return false;
+
+  while( len > 0 ) {
+    nl = memchr( ORIGBUFFER + off, '\n', len );
+    n  = nl ? (size_t)( nl - ( ORIGBUFFER + off )) + 1 : len;
+    _addScannedRow( off, n );
+    off += n;
+    len -= n;
+  }
+
+  BUFFERGEN++;
+  return true;
+}
+
+
+/*****************************************************************************************
+				       KILL RING
+*****************************************************************************************/
+
+/***
+    Kill Ring
+
+    The last KILLMAX kills and copies, yanked newest first; M-y then
+    swaps the text just yanked for the kill before it.  Text within a
+    line is copied.  Text across lines is held the way undo holds
+    deleted rows, as row descriptors, the rows at either end cut to the
+    text: killing or copying a million lines copies no text.  Yanking
+    it at the start of a line puts the same rows back; elsewhere the
+    text of the first row is copied in, and after it that of a last row
+    the text ends within.
+***/
+#define KILLMAX 32			     /* Kills Kept */
+
+typedef struct {
+  row_t *rows;				     /* Rows Held, NULL If Copied */
+  int    n;
+  char  *txt;				     /* Copied Text */
+  size_t len;
+} kill_t;
+
+static struct {
+  kill_t ring[ KILLMAX ];
+  int    n;				     /* Kills Held */
+  int    top;				     /* Slot of the Newest */
+  int    at;				     /* Age of the Kill Last Yanked */
+  bool   yankP;				     /* Is the Last Yank in Place? */
+  unsigned long gen;			     /* Buffer Generation After It */
+  int    row, col, endRow, endCol;	     /* Text It Inserted */
+} KILLS;
+
+/* Free a Kill's Text or Rows */
+static void _freeKill( kill_t *k ) {
+
+  free( k->rows );
+  free( k->txt );
+
+  memset( k, 0, sizeof( kill_t ));
+}
+
+/* Empty the Kill Ring */
+void emptyKillRing( void ) {
+
+  for( int i = 0; i<KILLMAX; i++ )
+    _freeKill( &KILLS.ring[i] );
+
+  KILLS.n     = KILLS.top = KILLS.at = 0;
+  KILLS.yankP = false;
+}
+
+/* Slot for a New Kill, Dropping the Oldest When Full */
+static kill_t *_pushKill( void ) {
+
+  KILLS.top = ( KILLS.top + 1 ) % KILLMAX;
+  _freeKill( &KILLS.ring[ KILLS.top ] );
+
+  if( KILLS.n < KILLMAX )
+    KILLS.n++;
+  KILLS.yankP = false;
+
+  return &KILLS.ring[ KILLS.top ];
+}
+
+/* Kill a Copy of len Bytes From Column col of row */
+static void _pushKillRow( int row, int col, size_t len ) {
+
+  kill_t *k = _pushKill();
+  row_t r   = _row( row );
+
+  if(( k->txt = malloc( len )) == NULL )
+    die( "_pushKillRow: malloc failed" );
+
+  _copyRowText( &r, col, len, k->txt );
+  k->len = len;
+}
+
+/* Held Part of row, n Bytes From Column from */
+static row_t _holdPart( int row, size_t from, size_t n ) {
+
+  row_t r    = _row( row );
+  row_t part = _partRow( &r, from, n );
+
+  if( _holdRowText( &part ))
+    ADDFROZEN = ADDBUFFER.used;
+
+  return part;
+}
+
+/***
+    Kill the Text From (row,col) Up to (endRow,endCol)
+
+    Called before the text is removed, or to copy it.  endRow may be
+    the row count, ending the text after the last line.  Returns false,
+    keeping nothing, when there is no text.
+***/
+bool pushKillRegion( int row, int col, int endRow, int endCol ) {
+
+  kill_t *k;
+  int n;
+
+  if( fileViewP() || row < 0 || endRow < row )
+    return false;
+
+  /* Text Up to the Row Count Ends With the Last Row */
+  if( endRow == getBufferNumRows() && endRow > 0 ) {
+    endRow--;
+    endCol = getBufferLineLen( endRow );
+  }
+
+  if( endRow == row && endCol <= col )
+    return false;
+
+  if( endRow == row ) {
+    _pushKillRow( row, col, endCol - col );
+    return true;
+  }
+
+  /* Rows Between Whole, the Last Only If the Text Reaches Into It */
+  n = endRow - row + ( endCol > 0 );
+  k = _pushKill();
+  if(( k->rows = malloc( n * sizeof( row_t ))) == NULL )
+    die( "pushKillRegion: malloc failed" );
+
+  k->rows[0] = _holdPart( row, col, getBufferLineLen( row ) - col );
+  holdBufferRows( row + 1, endRow - row - 1, k->rows + 1 );
+  if( endCol > 0 )
+    k->rows[ n-1 ] = _holdPart( endRow, 0, endCol );
+  k->n = n;
+
+  return true;
+}
+
+/* Does r End in a Newline? */
+static bool _endsLineP( const row_t *r ) {
+
+  char c = '\n';
+
+  if( r->len > 0 )
+    _copyRowText( r, r->len - 1, 1, &c );
+
+  return c == '\n';
+}
+
+/* Splice a Copy of n Bytes of Held Row r Into row at col */
+static void _spliceHeldText( int row, int col, const row_t *r, size_t n ) {
+
+  char *txt;
+
+  if(( txt = malloc( n + 1 )) == NULL )
+    die( "_spliceHeldText: malloc failed" );
+
+  _copyRowText( r, 0, n, txt );
+  spliceBufferLineText( row, col, col, txt, n );
+  free( txt );
+}
+
+/* Insert Kill k, Spanning Rows, at (row,col); Returns the End */
+static int _yankRows( const kill_t *k, int row, int col, int *endCol ) {
+
+  const row_t *last = &k->rows[ k->n - 1 ];
+  int whole = _endsLineP( last ) ? k->n : k->n - 1;
+  int first = 0;
+
+  /* Break the Line at col, Then Add the First Row's Text */
+  if( col > 0 ) {
+    _splitRow( row, col );
+    _spliceHeldText( row, col, &k->rows[0], k->rows[0].len - 1 );
+    first = 1;
+    row++;
+  }
+
+  /* Whole Rows Are Shared */
+  if( whole > first ) {
+    _insertRows( row, k->rows + first, whole - first );
+    row += whole - first;
+  }
+
+  /* A Last Row Without Its Newline Goes Before the Text After col */
+  *endCol = 0;
+  if( whole < k->n ) {
+    _spliceHeldText( row, 0, last, last->len );
+    *endCol = last->len;
+  }
+
+  return row;
+}
+
+/* Insert Kill k at (row,col), Remembering Where It Went */
+static int _yankKill( const kill_t *k, int row, int col, int *endCol ) {
+
+  KILLS.row = row;
+  KILLS.col = col;
+
+  if( k->rows )
+    row = _yankRows( k, row, col, endCol );
+  else
+    row = insertBufferText( row, col, k->txt, k->len, endCol );
+
+  KILLS.yankP  = true;
+  KILLS.gen    = BUFFERGEN;
+  KILLS.endRow = row;
+  KILLS.endCol = *endCol;
+
+  return row;
+}
+
+/***
+    Yank the Newest Kill at (row,col)
+
+    Returns the row the text ends on, and its column in *endCol, or -1
+    when the ring is empty.
+***/
+int yankKillRing( int row, int col, int *endCol ) {
+
+  if( KILLS.n == 0 )
+    return -1;
+
+  KILLS.at = 0;
+  return _yankKill( &KILLS.ring[ KILLS.top ], row, col, endCol );
+}
+
+/***
+    Replace the Text Just Yanked With the Kill Before It
+
+    Only while the buffer is as the yank left it.  Returns the row the
+    text ends on, and its column in *endCol, or -1 if there was no yank.
+***/
+int yankPopKillRing( int *endCol ) {
+
+  int row = KILLS.row, col = KILLS.col;
+
+  if( !KILLS.yankP || KILLS.gen != BUFFERGEN )
+    return -1;
+
+  freeBufferText( row, col, KILLS.endRow, KILLS.endCol );
+
+  KILLS.at = ( KILLS.at + 1 ) % KILLS.n;
+  return _yankKill( &KILLS.ring[( KILLS.top - KILLS.at + KILLMAX ) % KILLMAX ],
+		    row, col, endCol );
+}
+
+/* Copy Kills' Rows Out of File Text an In-Place Save Rewrites */
+static void _privateKills( void ) {
+
+  for( int i = 0; i<KILLMAX; i++ )
+    for( int j = 0; j<KILLS.ring[i].n; j++ )
+      _privateHeldRow( &KILLS.ring[i].rows[j] );
+}
+
+/* Delete Point (thisRow,thisCol) to End of Line */
+void freeBufferPointToEOL( int thisRow, int thisCol ) {
+
+  int size = getBufferLineLen( thisRow ) - thisCol;
+
+  /* Save Killed Text, Less Its Newline, in the Kill Ring */
+  if( size > 0 && getBufferChar( thisRow, thisCol + size - 1 ) == '\n' )
+    size--;
+  if( size > 0 )
+    _pushKillRow( thisRow, thisCol, size );
+
+  /* Trim Line at Point */
+  spliceBufferLineText( thisRow, thisCol, getBufferLineLen( thisRow ), "\n", 1 );
+
+  return;
+}
+
+
+/***
+    Replace Text Between left and right in a Buffer Line
+
+    The last private line in the ADD buffer is edited in place, any
+    other line is first copied to the end of the ADD buffer.  Long lines
+    are chunked and only the chunks at the edit change.  The journal
+    records the splice, not the line.  txt must not point into the text
+    buffers.
+***/
+void spliceBufferLineText( int row, int left, int right, const char *txt, int len ) {
+
+  char *line = NULL;			     /* ADD Text Being Written */
+
+  /* Nothing to Do */
+  if(( left == right ) && ( len == 0 )) return;
+
+  undoSpliceRow( row, left, right, len );
+
+  row_t r       = _row( row );
+  row_t was     = r;
+  size_t oldLen = r.len;
+  size_t newLen = oldLen - ( right - left ) + len;
+
+  /* Long Line, Edit Its Chunks */
+  if( newLen > ( r.src == CHUNKTEXT ? CHUNKLINE / 2 : CHUNKLINE )) {
+
+    if( r.src != CHUNKTEXT )
+      r = _chunkText( &r, 0, oldLen );
+    _spliceChunks( &r, left, right, txt, len );
+    _spliceRow( row, r, left, right, txt, len );
+
+    if( row == EDITROW.row )
+      EDITROW.lPtr = EDITROW.rPtr = 0;
+    return;
+  }
+
+  /* Short Line, Keep It in the Row */
+  if( newLen <= INLINEMAX ) {
+
+    char tmp[INLINEMAX];
+
+    _copyRowText( &r, 0, left, tmp );
+    memcpy( tmp + left, txt, len );
+    _copyRowText( &r, right, oldLen - right, tmp + left + len );
+
+    /* Give Back Private Tail Text */
+    if( _rowAtAddTailP( &r ))
+      ADDBUFFER.used = r.off;
+
+    _setInlineText( &r, tmp, newLen );
+  }
+
+  /* Line Already Last in ADD Buffer, Edit In Place */
+  else if( _rowAtAddTailP( &r ) && arenaFitsP( &ADDBUFFER, r.off, newLen )) {
+
+    line = arenaPtr( &ADDBUFFER, r.off );
+    memmove( line + left + len, line + right, oldLen - right );
+  }
+
+  /* First Edit of This Line, Copy It to ADD Buffer */
+  else {
+
+    size_t off = arenaReserve( &ADDBUFFER, newLen );
+
+    line = arenaPtr( &ADDBUFFER, off );
+    _copyRowText( &r, 0, left, line );
+    _copyRowText( &r, right, oldLen - right, line + left + len );
+
+    r.src = ADDTEXT;
+    r.off = off;
+  }
+
+  if( line != NULL ) {
+    memcpy( line + left, txt, len );
+    ADDBUFFER.used = r.off + newLen;
+    r.len = newLen;
+    _internRow( &r );
+  }
+
+  _spliceRow( row, r, left, right, txt, len );
+
+  /* Line Shrank Back From Chunks */
+  if( was.src == CHUNKTEXT )
+    _dropChunks( _chunkOf( &was ));
+
+  /* Gap Was Consumed */
+  if( row == EDITROW.row )
+    EDITROW.lPtr = EDITROW.rPtr = 0;
+
+  return;
+}
+
+
+/* Replace Text String in Buffer Line */
+void replaceBufferLineText( int row, int newLen, char *newTxt ) {
+
+  spliceBufferLineText( row, 0, getBufferLineLen( row ), newTxt, newLen );
+
+  return;
+}
+
+/* Split row at col, the Text From col On Becoming the Next Row */
+static void _splitRow( int row, int col ) {
+
+  /* New Line References Text After col, Short Text is Copied */
+  row_t r  = _row( row );
+  row_t nr = _partRow( &r, col, r.len - col );
+
+  /* Shared ADD Text is Frozen */
+  if( nr.src == ADDTEXT || nr.src == CHUNKTEXT )
+    ADDFROZEN = ADDBUFFER.used;
+
+  _insertRows( row + 1, &nr, 1 );
+
+  /* Trim This Line at col, a Last Line Without Newline Ends at r.len */
+  if( (size_t)col == r.len || getBufferChar( row, col ) != '\n' )
+    spliceBufferLineText( row, col, r.len, "\n", 1 );
+}
+
+/***
+    Insert len Bytes of txt at Column col of row, Any Number of Lines
+
+    The text after col moves to the end of the last line of txt.  The
+    lines between go to the ADD buffer as one block and into the line
+    table a leaf at a time, so pasting a million lines costs a copy of
+    the text and no work per character.  Returns the row holding the
+    end of txt, and its column in *endCol.  txt must not point into the
+    text buffers.
+***/
+int insertBufferText( int row, int col, const char *txt, size_t len, int *endCol ) {
+
+  const char *first = memchr( txt, '\n', len );
+  const char *last  = txt + len;
+  const char *p, *nl;
+  row_t *rows;
+  size_t block = 0, at;
+  int n = 0, i;
+
+  /* One Line, Just a Splice */
+  if( first == NULL ) {
+    spliceBufferLineText( row, col, col, txt, len );
+    *endCol = col + len;
+    return row;
+  }
+
+  while( last[-1] != '\n' )
+    last--;
+
+  /* Break the Line at col, Then Add the First Line's Text */
+  _splitRow( row, col );
+  spliceBufferLineText( row, col, col, txt, first - txt );
+
+  /* Rows for the Lines Between, Long Ones Reading One Block */
+  for( p = first + 1; p < last; p = nl + 1 ) {
+    nl = memchr( p, '\n', last - p );
+    n++;
+    if( nl - p + 1 > (ptrdiff_t)INLINEMAX )
+      block = last - ( first + 1 );
+  }
+
+  if( n > 0 ) {
+    if(( rows = malloc( n * sizeof( row_t ))) == NULL )
+      die( "insertBufferText: malloc failed" );
+
+    at = ( block && !_internP() ) ? arenaAppend( &ADDBUFFER, first + 1, block ) : 0;
+
+    for( i = 0, p = first + 1; p < last; p = nl + 1, i++ ) {
+      nl = memchr( p, '\n', last - p );
+      rows[i].len = nl - p + 1;
+      if( rows[i].len <= INLINEMAX )
+	_setInlineText( &rows[i], p, rows[i].len );
+      else {
+	rows[i].src = ADDTEXT;
+	rows[i].off = _internP() ? _addText( p, rows[i].len ) : at + ( p - ( first + 1 ));
+      }
+    }
+
+    _insertRows( row + 1, rows, n );
+    free( rows );
+  }
+
+  /* Last Line's Text Goes Before the Text After col */
+  row += n + 1;
+  spliceBufferLineText( row, 0, 0, last, txt + len - last );
+  *endCol = txt + len - last;
+
+  return row;
+}
+
+/* Open a New Line */
+void openLine( void ) {
+
+  int PtY = getPointY();
+
+  _splitRow( getRowOffset() + getPointY(), getBufferCol() );
+
+  clrtoeol();
+  
+  /* Move Point */
+  setPointX( 0 );
+  setColOffset( 0 );
+  if( PtY == getScreenRows() )
+    setRowOffset( getRowOffset() + 1 );
+  else
+    setPointY( ++PtY );
+}
+
+/* Combine 'This' Text Line With Prior Text Line */
+void combineLineWithPrior( void ) {
+
+  int thisRow = getRowOffset() + getPointY();
+  
+  if( thisRow == 0 )
+    return;
+
+  row_t prior = _row( thisRow-1 );
+  row_t next  = _row( thisRow );
+  row_t was   = prior;
+  chunk_t *c;
+  int i;
+
+  int preLineLen = prior.len - 1;
+  int nxtLineLen = next.len;
+
+  /* Join Undoes as a Splice and a Row Insert */
+  undoSpliceRow( thisRow-1, preLineLen, preLineLen + 1, nxtLineLen );
+
+  /* Long Joined Line, Chain the Chunks of Both */
+  if( preLineLen + nxtLineLen > CHUNKLINE ||
+      (( prior.src == CHUNKTEXT || next.src == CHUNKTEXT ) &&
+       preLineLen + nxtLineLen > CHUNKLINE / 2 )) {
+
+    if( prior.src != CHUNKTEXT )
+      prior = _chunkText( &prior, 0, preLineLen );
+    else {
+      c = _ownChunks( &prior );
+      i = _cutChunks( c, preLineLen );
+      _closeChunks( c, i, c->n - i );
+    }
+
+    c = _chunkOf( &prior );
+    i = c->n;
+    _appendText( c, &next, 0, nxtLineLen );
+    _recountChunks( c, i );
+    prior.len = c->len;
+
+    setLineTableRow( thisRow-1, prior );
+    BUFFERGEN++;
+    _changedRow( thisRow-1 );
+    journalSpliceRow( thisRow-1, preLineLen, preLineLen + 1, _rowText( &next ), nxtLineLen );
+  }
+
+  /* Joined Line is Short, Keep It in the Row */
+  else if( preLineLen + nxtLineLen <= (int)INLINEMAX ) {
+    char tmp[INLINEMAX];
+
+    _copyRowText( &prior, 0, preLineLen, tmp );
+    _copyRowText( &next, 0, nxtLineLen, tmp + preLineLen );
+    _setInlineText( &prior, tmp, preLineLen + nxtLineLen );
+  }
+
+  else {
+
+    /* Make Prior Line the Private End of ADD Buffer */
+    if( _rowAtAddTailP( &prior ) &&
+	arenaFitsP( &ADDBUFFER, prior.off, preLineLen + nxtLineLen )) {
+      ADDBUFFER.used = prior.off + preLineLen;
+    }
+    else {
+      size_t off = arenaReserve( &ADDBUFFER, preLineLen + nxtLineLen );
+      _copyRowText( &prior, 0, preLineLen, arenaPtr( &ADDBUFFER, off ));
+      prior.off = off;
+      prior.src = ADDTEXT;
+      ADDBUFFER.used = off + preLineLen;
+    }
+
+    /* Append Next Line Text */
+    if( next.src == CHUNKTEXT )
+      _copyRowText( &next, 0, nxtLineLen, _rowText( &prior ) + preLineLen );
+    else
+      memmove( _rowText( &prior ) + preLineLen, _rowText( &next ), nxtLineLen );
+    ADDBUFFER.used += nxtLineLen;
+    prior.len = preLineLen + nxtLineLen;
+    _internRow( &prior );
+  }
+
+  if( prior.src != CHUNKTEXT ) {
+    _setRow( thisRow-1, prior );
+    if( was.src == CHUNKTEXT )
+      _dropChunks( _chunkOf( &was ));
+  }
+
+  /* Destroy Next Line, Undo Holds Its Text First */
   freeBufferLine( thisRow );
+  if( next.src == CHUNKTEXT )
+    _dropChunks( _chunkOf( &next ));
 
   setPointY( getPointY() - 1 );
   setPointX( preLineLen );
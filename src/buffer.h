@@ -1,17 +1,15 @@
 #include <stddef.h>
 
-/* Text Line Data Structures */
+/* Text Source Buffers */
+enum _ts { ORIGTEXT, ADDTEXT, INLINETEXT, CHUNKTEXT };
+
+/* Text Line, Packed by the Line Table */
 typedef struct {
-  char  *txt;				/* Editor Text Line */
+  size_t off;				/* Offset of Text, Inline Text, or Chunks */
   size_t len;				/* Length of Text */
-  size_t lPtr;				/* Editor Pointers */
-  size_t rPtr;
-  bool   editP;				/* This Row Edited Predicate */
+  enum _ts src;				/* Text Source Buffer */
 } row_t;
 
-/* Buffer Pointer Type */
-typedef row_t** buff_t;
-
 /* Empty Buffer : Default or User Named */
 enum _bn { DEFAULT, UNAMED };
 
@@ -23,21 +21,29 @@ int getBufferCol( void );
 
 /* Buffer Management */
 void initializeBuffer( void );
-buff_t getBufferHandle( void );
 void openEmptyBuffer( enum _bn );
 void readBufferFile( char * );
+void viewBufferFile( char * );
 void saveBuffer( void );
 void saveBufferNewName( void );
-void doubleBufferSize( void );
-bool bufferFullP( void );
+void pollBufferSave( void );
+void finishBufferSave( void );
+void trimBufferMemory( void );
+void reportBufferMemory( void );
 void closeBuffer( void );
 void killBuffer( void );
 
 /* Buffer Information */
 int getBufferLineLen( int ); 
+size_t getBufferBytes( void );
+size_t getBufferOffset( int, int );
+int findBufferByte( size_t * );
 char getBufferChar( int, int );
 void setBufferChar( int, int, char );
 char *getBufferTextLine( int );
+char *getBufferTextSpan( int, int, int * );
+void prefetchBufferRows( int, int );
+unsigned long getBufferGeneration( void );
 bool bufferLineModifiedP( int );
 bool bufferRowEditedP( int );
 void setBufferRowEdited( int, bool );
@@ -49,18 +55,34 @@ int getBufferGapSize( int );
 
 /* Modify Buffer Lines */
 void freeBufferLine( int );
+void freeBufferLines( int, int );
+void freeBufferText( int, int, int, int );
 void freeBufferPointToEOL( int, int );
 void replaceBufferLineText( int, int, char * );
+void spliceBufferLineText( int, int, int, const char *, int );
 void openLine( void );
+void insertBufferLine( int, const char *, int );
+int insertBufferText( int, int, const char *, size_t, int * );
+void holdBufferRows( int, int, row_t * );
+void restoreBufferRows( int, const row_t *, int );
+bool appendBufferFileRows( size_t, size_t );
 
 /* Edit Buffer Information */
 void setBufferGapPtrs( int, int, int );
 void increaseBufferGap( int );
 void combineLineWithPrior( void );
 
-/* Killbuffer Management */
-void emptyKillBuffer( void );
-int getKillBufferLength( void );
-char *getKillBufferPtr( void );
-void freeBufferPointToEOL( int, int );
+/* Buffer Snapshots */
+typedef struct _bufsnap bufferSnap_t;
+bufferSnap_t *snapBuffer( void );
+int getBufferSnapRows( bufferSnap_t * );
+bool walkBufferSnap( bufferSnap_t *, int, bool (*)( const char *, row_t, void * ),
+		     void * );
+void releaseBufferSnap( bufferSnap_t * );
+
+/* Kill Ring */
+void emptyKillRing( void );
+bool pushKillRegion( int, int, int, int );
+int yankKillRing( int, int, int * );
+int yankPopKillRing( int * );
 
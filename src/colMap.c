@@ -0,0 +1,177 @@
+/***
+==========================================================================================
+                      _              _         _____    _ _ _
+                     / \   _ __   __| |_   _  | ____|__| (_) |_
+                    / _ \ | '_ \ / _` | | | | |  _| / _` | | __|
+                   / ___ \| | | | (_| | |_| | | |__| (_| | | |_
+                  /_/   \_\_| |_|\__,_|\__, | |_____\__,_|_|\__|  v0.5-beta
+                                       |___/
+
+        Copyright 2020 (andrew.suttles@gmail.com)
+        MIT LICENSE
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+ INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE 
+ LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT 
+ OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ DEALINGS IN THE SOFTWARE.
+
+ AndyEDIT is a simple, line-oriented, terminal-based text editor with emacs-like keybindings.
+
+ For more information about AndyEdit, see README.md.
+
+==========================================================================================
+ ***/
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ae.h"
+#include "buffer.h"
+#include "colMap.h"
+
+/***
+    Display Column Maps
+
+    Lines keep their tabs.  A tab moves the display column to the next
+    multiple of TABSZ, so bytes and screen columns differ on lines that
+    hold tabs.  The first time a line is asked about, the byte index of
+    each tab and the column just after it are recorded.  Maps are cached
+    by row until the buffer text changes; lines without tabs need none.
+***/
+
+/* Module Constants */
+#define TABSZ    8			     /* Columns per Tab Stop */
+#define MAPSLOTS 64			     /* Cached Maps, About a Screen */
+
+/* Tab Positions of One Line */
+typedef struct {
+  int   row;				     /* Row Mapped, -1 if None */
+  unsigned long gen;			     /* Buffer Generation Mapped */
+  int   n;				     /* Tabs in Line */
+  int   size;				     /* Tabs Reserved */
+  int  *tabByte;			     /* Byte Index of Each Tab */
+  int  *tabCol;				     /* Display Column After Each Tab */
+} colmap_t;
+
+/* Module Private Data */
+static colmap_t MAPS[MAPSLOTS];
+static bool MAPSINITP = false;
+
+
+/*****************************************************************************************
+				      BUILD MAPS
+*****************************************************************************************/
+
+/* Column Reached After Showing c at Column col */
+int nextDisplayCol( int col, char c ) {
+
+  return ( c == '\t' ) ? ( col / TABSZ + 1 ) * TABSZ : col + 1;
+}
+
+/* Record a Tab */
+static void _addTab( colmap_t *m, int byte, int col ) {
+
+  if( m->n == m->size ) {
+    m->size = m->size ? m->size * 2 : 16;
+    if(( m->tabByte = realloc( m->tabByte, m->size * sizeof( int ))) == NULL ||
+       ( m->tabCol  = realloc( m->tabCol,  m->size * sizeof( int ))) == NULL )
+      die( "_addTab: realloc failed" );
+  }
+
+  m->tabByte[ m->n ] = byte;
+  m->tabCol[ m->n++ ] = col;
+}
+
+/* Get Map for row, Building It If Not Cached */
+static colmap_t *_getMap( int row ) {
+
+  int i, len, col, prev, at, span;
+  char *txt, *tab;
+  colmap_t *m;
+
+  if( !MAPSINITP ) {
+    for( i = 0; i<MAPSLOTS; i++ )
+      MAPS[i].row = -1;
+    MAPSINITP = true;
+  }
+
+  m = &MAPS[ row % MAPSLOTS ];
+  if( m->row == row && m->gen == getBufferGeneration() )
+    return m;
+
+  m->row = row;
+  m->gen = getBufferGeneration();
+  m->n   = 0;
+
+  /* Jump Between Tabs, Columns Advance One per Byte Between Them */
+  len  = getBufferLineLen( row );
+  col  = 0;
+  prev = 0;
+
+  for( at = 0; at < len; at += span ) {
+    txt = getBufferTextSpan( row, at, &span );
+    for( tab = txt; ( tab = memchr( tab, '\t', span - ( tab - txt ))) != NULL; tab++ ) {
+      i    = at + ( tab - txt );
+      col  = nextDisplayCol( col + ( i - prev ), '\t' );
+      prev = i + 1;
+      _addTab( m, i, col );
+    }
+  }
+
+  return m;
+}
+
+
+/*****************************************************************************************
+				     MAP LOOKUPS
+*****************************************************************************************/
+
+/* Display Column Where Byte col of row Begins */
+int getDisplayCol( int row, int col ) {
+
+  int lo, hi, mid;
+  colmap_t *m = _getMap( row );
+
+  /* Count Tabs Before col */
+  lo = 0;
+  hi = m->n;
+  while( lo < hi ) {
+    mid = ( lo + hi ) / 2;
+    if( m->tabByte[mid] < col ) lo = mid + 1;
+    else hi = mid;
+  }
+
+  if( lo == 0 )
+    return col;
+
+  return m->tabCol[lo-1] + ( col - m->tabByte[lo-1] - 1 );
+}
+
+/* Byte of row Shown at Display Column col, Last Byte if Past the End */
+int getDisplayByte( int row, int col ) {
+
+  int lo, hi, mid;
+
+  /* Last Byte Starting at or Before col */
+  lo = 0;
+  hi = getBufferLineLen( row ) - 1;
+  while( lo < hi ) {
+    mid = ( lo + hi + 1 ) / 2;
+    if( getDisplayCol( row, mid ) <= col ) lo = mid;
+    else hi = mid - 1;
+  }
+
+  return lo;
+}
+
+
+/***
+    Local Variables:
+    mode: c
+    tags-file-name: "~/ae/TAGS"
+    comment-column: 45
+    fill-column: 90
+    End:
+ ***/
@@ -0,0 +1,4 @@
+/* Display Columns of Tabbed Lines */
+int nextDisplayCol( int, char );
+int getDisplayCol( int, int );
+int getDisplayByte( int, int );
@@ -24,6 +24,7 @@
 ==========================================================================================
  ***/
 #include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include <curses.h>
@@ -36,10 +37,11 @@
 #include "minibuffer.h"
 #include "state.h"
 
-/* EDIT BUFFER */
-#define EBSZ 64
-static char EDITBUFFER[EBSZ];		     /* Edit Buffer For Text Input */
+/* EDIT BUFFER, Doubled as Needed and Kept, So Typing Stops Allocating */
+#define EBMIN 64
+static char *EDITBUFFER = NULL;		     /* Edit Buffer For Text Input */
 static int  EBINDEX   =  0;		     /* Edit Buffer Index */
+static int  EBMAX     =  0;		     /* Edit Buffer Size */
 
 /* Rectangles */
 static int recStrtRow = 0;		     /* Rectangle Coords */
@@ -52,6 +54,30 @@ static int recStopCol = 0;
 				    EDIT BUFFER STATUS
 *****************************************************************************************/
 
+/* Make Room for n More Chars */
+static void _reserveEditBuffer( int n ) {
+
+  int max = EBMAX ? EBMAX : EBMIN;
+
+  if( EDITBUFFER && EBINDEX + n <= EBMAX ) return;
+
+  while( max < EBINDEX + n )
+    max *= 2;
+
+  if(( EDITBUFFER = realloc( EDITBUFFER, max )) == NULL )
+    die( "editBuffer: realloc failed" );
+  EBMAX = max;
+}
+
+/* Replace Edit Buffer Chars With len Chars of txt */
+static void _setEditBufferText( const char *txt, int len ) {
+
+  EBINDEX = 0;
+  _reserveEditBuffer( len );
+  memcpy( EDITBUFFER, txt, len );
+  EBINDEX = len;
+}
+
 int getEditBufferIndex( void ) {
 
   return EBINDEX;
@@ -62,6 +88,12 @@ char getEditBufferChar(int i) {
   return EDITBUFFER[i];
 }
 
+char *getEditBufferPtr( void ) {
+
+  _reserveEditBuffer( 0 );
+  return EDITBUFFER;
+}
+
 void setEditBufferIndex( int x ) {
 
   EBINDEX = x;
@@ -112,6 +144,15 @@ void autoIndent( void ) {
 					CHARACTERS
 *****************************************************************************************/
 
+/* Move Point Back a Char, Scrolling If at the Window Edge */
+static void _pointBack( void ) {
+
+  if( getPointX() > 0 )
+    setPointX( getPointX() - 1 );
+  else
+    setColOffset( getColOffset() - 1 );
+}
+
 /* Insert User Typed Chars */
 void selfInsert( int c ) {
 
@@ -122,12 +163,13 @@ void selfInsert( int c ) {
   if( bufferRowEditedP( thisRow ))
     updateNavigationState();
 
-  /* Text Insertion Now Begins at POINT_X */  
+  /* Text Insertion Now Begins at POINT */  
   if( !bufferRowEditedP( thisRow )) {
-    setBufferGapPtrs( thisRow, PtX, PtX );
+    setBufferGapPtrs( thisRow, getBufferCol(), getBufferCol() );
     updateEditState();
   }
 
+  _reserveEditBuffer( 1 );
   EDITBUFFER[EBINDEX++] = c;
   setPointX( ++PtX );
 }
@@ -145,7 +187,7 @@ void deleteChar( void ) {
     /* Then, Save Insertions Befor Making Deletions */ 
       if( getBufferGapSize( thisRow ) == 0 ) {
 	updateLine();
-	setBufferGapPtrs( thisRow, getPointX(), getPointX() );
+	setBufferGapPtrs( thisRow, getBufferCol(), getBufferCol() );
       }
 
       /* Continue Deleting Chars Up to EOL  */
@@ -164,7 +206,7 @@ void deleteChar( void ) {
 /* Delete Back One Char */
 void backspace( void ) {
 
-  int PtX     = getPointX();
+  int col     = getBufferCol();
   int thisRow = getRowOffset() + getPointY();
   
   /* Continue Editing This Line? */
@@ -174,14 +216,14 @@ void backspace( void ) {
     /* Then, Save Insertions Befor Making Deletions */ 
     if( getBufferGapSize( thisRow ) == 0 ) {
       updateLine();
-      setBufferGapPtrs( thisRow, PtX, PtX );
+      setBufferGapPtrs( thisRow, col, col );
     }
 
     /* Continue Deleting Chars to BOL */
-    if( PtX > 0 ) {
-      setBufferGapPtrs( thisRow, PtX-1,
+    if( col > 0 ) {
+      setBufferGapPtrs( thisRow, col-1,
 			getBufferGapRightIndex(thisRow) );
-      setPointX( --PtX );
+      _pointBack();
     }
 
     /* At BOL, Combine With Prior Line */
@@ -194,10 +236,10 @@ void backspace( void ) {
   /* Begin *NEW* Edits to This Line */
   else {
 
-    if( PtX > 0 ) {
-      setBufferGapPtrs( thisRow, PtX-1, PtX );
+    if( col > 0 ) {
+      setBufferGapPtrs( thisRow, col-1, col );
       updateEditState();
-      setPointX( --PtX );
+      _pointBack();
     }
 
     else {
@@ -206,6 +248,27 @@ void backspace( void ) {
   }
 }
 
+/* Insert n Copies of c at Point, in One Splice */
+void insertCopies( int c, int n ) {
+
+  int row, col;
+  char *txt;
+
+  /* Save Prior Unsaved Changes to Text Row */
+  if( bufferRowEditedP( getBufferRow() ))
+    updateNavigationState();
+
+  if(( txt = malloc( n )) == NULL )
+    die( "insertCopies: malloc failed" );
+  memset( txt, c, n );
+
+  row = insertBufferText( getBufferRow(), getBufferCol(), txt, n, &col );
+  free( txt );
+
+  pointToRowCol( row, col );
+  setStatusFlagModified();
+}
+
 /*****************************************************************************************
 					  WORDS
 *****************************************************************************************/
@@ -214,16 +277,19 @@ void backspace( void ) {
 void killWord( void ) {
 
   int currPointX = getPointX();		/* Save Current Point */
+  int currColOff = getColOffset();
+  int currCol    = getBufferCol();
   int thisRow    = getRowOffset() + getPointY();
   
   forwardWord();			/* Find End Next Word */
 
-  if( getPointX() == currPointX )	/* No Word to Kill */
+  if( getBufferCol() == currCol )	/* No Word to Kill */
     return;
 
   /* Mark Word for Deletion and Restore Point */
-  setBufferGapPtrs( thisRow, currPointX, getPointX() );
+  setBufferGapPtrs( thisRow, currCol, getBufferCol() );
   setPointX( currPointX );
+  setColOffset( currColOff );
   updateEditState();
   updateNavigationState();
 }
@@ -349,8 +415,14 @@ void downcaseWord( void ) {
 /* Kill Line at Point */
 void killLine( void ) {
 
-  int thisRow = getRowOffset() + getPointY();
-  int thisCol = getColOffset() + getPointX();
+  int thisRow, thisCol;
+
+  /* Save Prior Unsaved Changes to Text Row */
+  if( bufferRowEditedP( getBufferRow() ))
+    updateNavigationState();
+
+  thisRow = getRowOffset() + getPointY();
+  thisCol = getColOffset() + getPointX();
   
   /* Line Empty - Delete it */
   if( getBufferLineLen( thisRow ) == 1 ) {
@@ -368,17 +440,73 @@ void killLine( void ) {
 }
 
 
-/* Kill Line at Point */
+/* Kill n Lines From Point, in One Range */
+void killLines( int n ) {
+
+  int thisRow = getBufferRow();
+  int thisCol = getBufferCol();
+  long endRow = (long)thisRow + n;
+  int endCol  = 0;
+
+  /* Save Prior Unsaved Changes to Text Row */
+  if( bufferRowEditedP( thisRow ))
+    updateNavigationState();
+
+  /* Fewer Lines Follow, Kill to the End of the Last */
+  if( endRow >= getBufferNumRows() ) {
+    endRow = getBufferNumRows() - 1;
+    endCol = getBufferLineLen( endRow );
+    if( endCol > 0 && getBufferChar( endRow, endCol - 1 ) == '\n' )
+      endCol--;
+  }
+
+  if( !pushKillRegion( thisRow, thisCol, endRow, endCol ))
+    return;
+
+  freeBufferText( thisRow, thisCol, endRow, endCol );
+
+  pointToRowCol( thisRow, thisCol );
+  setStatusFlagModified();
+
+  return;
+}
+
+
+/* Yank the Newest Kill at Point */
 void yankLine( void ) {
 
-  int i;
-  char *kb = getKillBufferPtr();
+  int row, col;
+
+  /* Save Prior Unsaved Changes to Text Row */
+  if( bufferRowEditedP( getBufferRow() ))
+    updateNavigationState();
+
+  if(( row = yankKillRing( getBufferRow(), getBufferCol(), &col )) < 0 )
+    return;
+
+  pointToRowCol( row, col );
+  setStatusFlagModified();
+
+  return;
+}
+
+/* Swap the Text Just Yanked for the Kill Before It */
+void yankPop( void ) {
+
+  int row, col;
 
-  for( i=0; i<getKillBufferLength(); i++ ) {
+  if( bufferRowEditedP( getBufferRow() ))
+    updateNavigationState();
 
-    selfInsert( kb[i] );
+  if(( row = yankPopKillRing( &col )) < 0 ) {
+    miniBufferMessage( "Previous command was not a yank" );
+    return;
   }
 
+  pointToRowCol( row, col );
+  setStatusFlagModified();
+  miniBufferMessage( "Yanked Text" );
+
   return;
 }
 
@@ -446,11 +574,12 @@ void killRectangle( void ) {
 void rectangleInsert( void ) {
 
   int row, lineLen;
+  char *txt;
   
   /* Get User Input */
   if( !regionActiveP() ) return;
   if( !miniBufferGetInput( "Text: " )) return;
-  strncpy( EDITBUFFER, miniBufferGetUserText(), EBSZ-1 );
+  txt = miniBufferGetUserText();
   
   _setupRectangle();
 
@@ -471,14 +600,12 @@ void rectangleInsert( void ) {
 	selfInsert( 'x' );
       }
 
-      /* EDITBUFFER Got Clobbered by selfInsert */
-      strncpy( EDITBUFFER, miniBufferGetUserText(), EBSZ-1 );
       updateNavigationState();
       setPointX( recStrtCol );
     }
 
     /* Setup Delete Area and Text Insertion Area */
-    setEditBufferIndex( strlen( EDITBUFFER ));
+    _setEditBufferText( txt, strlen( txt ));
     setBufferGapPtrs( row, recStrtCol, recStopCol );
     updateLine();
   }
@@ -503,6 +630,7 @@ void rectangleNumberLines( void ) {
   }
 
   int x = miniBufferGetPosInteger( "Starting Number: " );
+  char num[16];
 
   for( int row=recStrtRow; row<=recStopRow; row++ ) {
 
@@ -511,8 +639,8 @@ void rectangleNumberLines( void ) {
     // Handle Short Lines...
     
     /* Setup Edit Buffer and Update Line */
-    snprintf( EDITBUFFER, EBSZ, "%i", x );
-    setEditBufferIndex( strlen( EDITBUFFER ));
+    snprintf( num, sizeof( num ), "%i", x );
+    _setEditBufferText( num, strlen( num ));
     setBufferGapPtrs( row, recStrtCol, recStrtCol );
     updateLine();
     x++;
@@ -1,16 +1,20 @@
 int getEditBufferIndex( void );
 char getEditBufferChar( int );
+char *getEditBufferPtr( void );
 void setEditBufferIndex( int );
 void autoIndent( void );
 void selfInsert( int );
 void backspace( void );
+void insertCopies( int, int );
 void deleteChar( void );
 void killWord( void );
 void capitalizeWord( void );
 void upcaseWord( void );
 void downcaseWord( void );
 void killLine( void );
+void killLines( int );
 void yankLine( void );
+void yankPop( void );
 void killRectangle( void );
 void rectangleInsert( void );
 void rectangleNumberLines( void );
@@ -0,0 +1,995 @@
+/***
+==========================================================================================
+                      _              _         _____    _ _ _
+                     / \   _ __   __| |_   _  | ____|__| (_) |_
+                    / _ \ | '_ \ / _` | | | | |  _| / _` | | __|
+                   / ___ \| | | | (_| | |_| | | |__| (_| | | |_
+                  /_/   \_\_| |_|\__,_|\__, | |_____\__,_|_|\__|  v0.5-beta
+                                       |___/
+
+        Copyright 2020 (andrew.suttles@gmail.com)
+        MIT LICENSE
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+ INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE 
+ LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT 
+ OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ DEALINGS IN THE SOFTWARE.
+
+ AndyEDIT is a simple, line-oriented, terminal-based text editor with emacs-like keybindings.
+
+ For more information about AndyEdit, see README.md.
+
+==========================================================================================
+ ***/
+#define _POSIX_C_SOURCE 200809L		     /* pread(), fdatasync() are POSIX */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "ae.h"
+#include "buffer.h"
+#include "minibuffer.h"
+#include "state.h"
+#include "journal.h"
+
+/***
+    Edit Journal
+
+    Every change to buffer rows is appended to FILE.aej as a binary
+    record, so edits made since the last save survive a crash.  Records
+    are gathered in memory, then written and synced about once a second
+    while the editor waits for keys.  The journal header names the file
+    the edits apply to by device, inode, size and modification time;
+    opening that file again offers the edits for replay.  Records are in
+    host byte order and carry a checksum, so replay stops at a torn tail.
+    An edit within a line is recorded as a splice of the columns it
+    changed, not the whole line.
+
+    Once the journal passes JCOMPACT bytes, and has doubled since the
+    last checkpoint, a writer thread rewrites it from a buffer snapshot
+    as a checkpoint: runs of unedited file text
+    by offset, and the text of the other rows.  Records added while it
+    runs are carried over.  After a save the unedited rows still point
+    into the old file, so compaction waits until the file is reopened.
+
+    A save that rewrites the file in place first leaves FILE.aej.save,
+    which rebuilds the buffer being saved from the head of the file it
+    keeps.
+***/
+
+/* Module Constants */
+#define JMAGIC    "AEJ1"
+#define JBATCH    (1 << 16)		     /* Bytes Gathered per write */
+#define JSYNCSECS 1.0			     /* Longest Unsynced Interval */
+#define JCOMPACT  (1 << 24)		     /* Journal Size Starting Compaction */
+
+/* Record Operations */
+enum _jop { JSET, JINSERT, JDELETE, JCLEAR, JRUN, JSPLICE };
+
+/* Journal Header, Identifies the Base File */
+typedef struct {
+  char     magic[4];
+  uint32_t existsP;			     /* Base File Existed */
+  uint64_t dev;
+  uint64_t ino;
+  uint64_t size;
+  int64_t  mtime;
+  int64_t  mtimeNs;
+  uint64_t from;			     /* Head an In-Place Save Keeps, or 0 */
+} jhead_t;
+
+/* Record Header, len Bytes of Text Follow */
+typedef struct {
+  uint32_t op;
+  uint32_t len;
+  int64_t  row;				     /* Row, or File Offset for JRUN */
+  int64_t  arg;				     /* Row Count, Length for JRUN, Gap for JSPLICE */
+  uint32_t sum;				     /* Checksum of Record and Text */
+  uint32_t pad;
+} jrec_t;
+
+/* Module Private Data */
+static struct {
+  char   *path;				     /* Journal File, NULL If Off */
+  jhead_t head;				     /* Base File */
+  int     fd;				     /* -1 Until the First Record */
+  size_t  size;				     /* Bytes in File */
+  size_t  compacted;			     /* Bytes After Last Checkpoint */
+  char   *buf;				     /* Records Not Yet Written */
+  size_t  used;
+  size_t  max;
+  bool    dirtyP;			     /* Written Since Last Sync */
+  double  synced;			     /* Time of Last Sync */
+  bool    replayP;			     /* Replaying, Don't Record */
+  bool    baseP;			     /* File Rows Are Base File Text */
+  unsigned long epoch;			     /* Bumped When the File is Replaced */
+} JOURNAL = { .path = NULL, .fd = -1 };
+
+static struct {				     /* Background Compaction */
+  bool          activeP;
+  bool          threadP;
+  pthread_t     thread;
+  bufferSnap_t *snap;
+  char         *tmp;			     /* Checkpoint File, FILE.aej.new */
+  int           fd;
+  size_t        mark;			     /* Journal Length at Snapshot */
+  unsigned long epoch;
+
+  pthread_mutex_t lock;			     /* Guards the Fields Below */
+  bool          doneP;
+  bool          okP;
+} COMPACT = { .activeP = false, .lock = PTHREAD_MUTEX_INITIALIZER };
+
+
+/*****************************************************************************************
+				     JOURNAL RECORDS
+*****************************************************************************************/
+
+/* Seconds on the Monotonic Clock */
+static double _now( void ) {
+
+  struct timespec ts;
+
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* FNV-1a Checksum of a Record and Its Text */
+static uint32_t _sum( const jrec_t *rec, const char *txt ) {
+
+  uint32_t h = 2166136261u;
+  jrec_t r = *rec;
+  const unsigned char *p = (const unsigned char *)&r;
+  size_t i;
+
+  r.sum = 0;
+  for( i = 0; i<sizeof( jrec_t ); i++ )
+    h = ( h ^ p[i] ) * 16777619u;
+
+  p = (const unsigned char *)txt;
+  for( i = 0; i<rec->len; i++ )
+    h = ( h ^ p[i] ) * 16777619u;
+
+  return h;
+}
+
+/* Identify fn As It Is on Disk */
+static void _identify( const char *fn, jhead_t *h ) {
+
+  struct stat sb;
+
+  memset( h, 0, sizeof( jhead_t ));
+  memcpy( h->magic, JMAGIC, 4 );
+
+  if( stat( fn, &sb ) == -1 )
+    return;
+
+  h->existsP = 1;
+  h->dev     = sb.st_dev;
+  h->ino     = sb.st_ino;
+  h->size    = sb.st_size;
+  h->mtime   = sb.st_mtim.tv_sec;
+  h->mtimeNs = sb.st_mtim.tv_nsec;
+}
+
+/* Write All len Bytes, Picking Up After Short Writes */
+static bool _writeAll( int fd, const char *p, size_t len ) {
+
+  ssize_t n;
+
+  while( len > 0 ) {
+    if(( n = write( fd, p, len )) == -1 ) {
+      if( errno == EINTR ) continue;
+      return false;
+    }
+    p   += n;
+    len -= n;
+  }
+
+  return true;
+}
+
+/* Stop Journaling, Telling the User Why */
+static void _journalFailed( void ) {
+
+  char msgBuffer[ 128 ];
+
+  snprintf( msgBuffer, 128, "Journal off: %s", strerror( errno ));
+  miniBufferMessage( msgBuffer );
+
+  if( JOURNAL.fd != -1 )
+    close( JOURNAL.fd );
+  JOURNAL.fd = -1;
+
+  free( JOURNAL.path );
+  JOURNAL.path = NULL;
+  JOURNAL.used = 0;
+}
+
+/* Write Gathered Records, Creating the Journal on First Use */
+static void _flushJournal( bool syncP ) {
+
+  if( JOURNAL.path == NULL )
+    return;
+
+  if( JOURNAL.used > 0 ) {
+
+    if( JOURNAL.fd == -1 ) {
+      JOURNAL.fd = open( JOURNAL.path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0600 );
+      if( JOURNAL.fd == -1 ||
+	  !_writeAll( JOURNAL.fd, (char *)&JOURNAL.head, sizeof( jhead_t ))) {
+	_journalFailed();
+	return;
+      }
+      JOURNAL.size = sizeof( jhead_t );
+    }
+
+    if( !_writeAll( JOURNAL.fd, JOURNAL.buf, JOURNAL.used )) {
+      _journalFailed();
+      return;
+    }
+
+    JOURNAL.size  += JOURNAL.used;
+    JOURNAL.used   = 0;
+    JOURNAL.dirtyP = true;
+  }
+
+  if( syncP && JOURNAL.dirtyP ) {
+    fdatasync( JOURNAL.fd );
+    JOURNAL.dirtyP = false;
+  }
+
+  if( syncP )
+    JOURNAL.synced = _now();
+}
+
+/* Gather a Record */
+static void _record( enum _jop op, int64_t row, int64_t arg, const char *txt, size_t len ) {
+
+  jrec_t rec = { op, len, row, arg, 0, 0 };
+
+  if( JOURNAL.path == NULL || JOURNAL.replayP )
+    return;
+
+  rec.sum = _sum( &rec, txt );
+
+  if( JOURNAL.used + sizeof( jrec_t ) + len > JOURNAL.max ) {
+    while( JOURNAL.used + sizeof( jrec_t ) + len > JOURNAL.max )
+      JOURNAL.max = JOURNAL.max ? JOURNAL.max * 2 : JBATCH;
+    if(( JOURNAL.buf = realloc( JOURNAL.buf, JOURNAL.max )) == NULL )
+      die( "_record: realloc failed" );
+  }
+
+  memcpy( JOURNAL.buf + JOURNAL.used, &rec, sizeof( jrec_t ));
+  memcpy( JOURNAL.buf + JOURNAL.used + sizeof( jrec_t ), txt, len );
+  JOURNAL.used += sizeof( jrec_t ) + len;
+
+  if( JOURNAL.used >= JBATCH )
+    _flushJournal( false );
+}
+
+/* Buffer Hooks */
+void journalSetRow( int row, const char *txt, size_t len ) {
+
+  _record( JSET, row, 0, txt, len );
+}
+
+void journalInsertRow( int row, const char *txt, size_t len ) {
+
+  _record( JINSERT, row, 0, txt, len );
+}
+
+void journalDeleteRows( int row, int count ) {
+
+  _record( JDELETE, row, count, NULL, 0 );
+}
+
+/* Columns left to right of row Replaced, Packed Into One Argument */
+static int64_t _gap( int64_t left, int64_t right ) {
+
+  return ( left << 32 ) | right;
+}
+
+void journalSpliceRow( int row, int left, int right, const char *txt, size_t len ) {
+
+  _record( JSPLICE, row, _gap( left, right ), txt, len );
+}
+
+
+/*****************************************************************************************
+				    REPLAY AND RECOVERY
+*****************************************************************************************/
+
+/* Apply One Record, false If It Does Not Fit the Buffer */
+static bool _apply( const jrec_t *rec, const char *txt ) {
+
+  int64_t rows = getBufferNumRows();
+  int64_t left, right;
+
+  switch( rec->op ) {
+
+  case JSET:
+    if( rec->row < 0 || rec->row >= rows ) return false;
+    replaceBufferLineText( rec->row, rec->len, (char *)txt );
+    return true;
+
+  case JINSERT:
+    if( rec->row < 0 || rec->row > rows ) return false;
+    insertBufferLine( rec->row, txt, rec->len );
+    return true;
+
+  case JDELETE:
+    if( rec->row < 0 || rec->arg < 0 || rec->row + rec->arg > rows ) return false;
+    freeBufferLines( rec->row, rec->arg );
+    return true;
+
+  case JCLEAR:
+    freeBufferLines( 0, rows );
+    return true;
+
+  case JRUN:
+    if( rec->row < 0 || rec->arg < 0 ) return false;
+    return appendBufferFileRows( rec->row, rec->arg );
+
+  case JSPLICE:
+    left  = rec->arg >> 32;
+    right = rec->arg & 0xffffffff;
+    if( rec->row < 0 || rec->row >= rows || left > right ||
+	right > getBufferLineLen( rec->row ))
+      return false;
+    spliceBufferLineText( rec->row, left, right, txt, rec->len );
+    return true;
+  }
+
+  return false;
+}
+
+/* Length of the Valid Records in txt, Counting Them in *count */
+static size_t _validRecords( const char *txt, size_t len, int *count ) {
+
+  size_t at = 0;
+  jrec_t rec;
+
+  *count = 0;
+
+  while( len - at >= sizeof( jrec_t )) {
+    memcpy( &rec, txt + at, sizeof( jrec_t ));
+    if( rec.op > JSPLICE ||
+	rec.len > len - at - sizeof( jrec_t ) ||
+	rec.sum != _sum( &rec, txt + at + sizeof( jrec_t )))
+      break;
+    at += sizeof( jrec_t ) + rec.len;
+    (*count)++;
+  }
+
+  return at;
+}
+
+/* Replay Valid Records, Return Bytes Applied */
+static size_t _replay( const char *txt, size_t len ) {
+
+  size_t at = 0;
+  jrec_t rec;
+
+  JOURNAL.replayP = true;
+
+  while( at < len ) {
+    memcpy( &rec, txt + at, sizeof( jrec_t ));
+    if( !_apply( &rec, txt + at + sizeof( jrec_t )))
+      break;
+    at += sizeof( jrec_t ) + rec.len;
+  }
+
+  JOURNAL.replayP = false;
+
+  if( getBufferNumRows() == 0 )
+    openEmptyBuffer( UNAMED );
+
+  return at;
+}
+
+/* Read the Whole Journal, NULL If It Can't Be Read */
+static char *_readJournal( int fd, size_t *len ) {
+
+  struct stat sb;
+  char *txt;
+  ssize_t n;
+  size_t got = 0;
+
+  if( fstat( fd, &sb ) == -1 )
+    return NULL;
+
+  if(( txt = malloc( sb.st_size + 1 )) == NULL )
+    die( "_readJournal: malloc failed" );
+
+  while( got < (size_t)sb.st_size ) {
+    if(( n = read( fd, txt + got, sb.st_size - got )) <= 0 ) {
+      if( n == -1 && errno == EINTR ) continue;
+      break;
+    }
+    got += n;
+  }
+
+  *len = got;
+  return txt;
+}
+
+/***
+    Offer Edits Left in a Journal
+
+    A journal for a different version of the file is left alone until
+    the first edit overwrites it.  Accepted edits are replayed and the
+    journal carries on from its last good record.
+***/
+static void _recover( void ) {
+
+  int fd, count;
+  size_t len, valid, applied;
+  char *txt, msgBuffer[ 128 ];
+  jhead_t head;
+
+  if(( fd = open( JOURNAL.path, O_RDWR | O_APPEND )) == -1 )
+    return;
+
+  if(( txt = _readJournal( fd, &len )) == NULL ) {
+    close( fd );
+    return;
+  }
+
+  memcpy( &head, txt, len < sizeof( jhead_t ) ? len : sizeof( jhead_t ));
+
+  if( len < sizeof( jhead_t ) ||
+      memcmp( &head, &JOURNAL.head, sizeof( jhead_t )) != 0 ) {
+    if( len >= sizeof( jhead_t ))
+      miniBufferMessage( "Journal is for another version of this file, ignored" );
+    free( txt );
+    close( fd );
+    return;
+  }
+
+  valid = _validRecords( txt + sizeof( jhead_t ), len - sizeof( jhead_t ), &count );
+
+  snprintf( msgBuffer, 128, "Recover %d edits from %s? [Y/N] ", count, JOURNAL.path );
+
+  if( count == 0 || !miniBufferGetYN( msgBuffer )) {
+    free( txt );
+    close( fd );
+    unlink( JOURNAL.path );
+    return;
+  }
+
+  applied = _replay( txt + sizeof( jhead_t ), valid );
+  free( txt );
+
+  /* Carry On After the Last Record Applied */
+  JOURNAL.fd   = fd;
+  JOURNAL.size = JOURNAL.compacted = sizeof( jhead_t ) + applied;
+  if( ftruncate( fd, JOURNAL.size ) == -1 )
+    _journalFailed();
+
+  setStatusFlagModified();
+
+  snprintf( msgBuffer, 128, "Recovered %d edits", count );
+  miniBufferMessage( msgBuffer );
+}
+
+
+/* In-Place Save Journal Beside fn */
+static char *_savePath( const char *fn ) {
+
+  char *path;
+
+  if(( path = malloc( strlen( fn ) + 10 )) == NULL )
+    die( "_savePath: malloc failed" );
+  sprintf( path, "%s.aej.save", fn );
+
+  return path;
+}
+
+/***
+    Offer to Finish a Save Cut Short
+
+    A save journal left for this file means an in-place save stopped
+    part way, after the journal was complete.  The head it kept is
+    still good, and replaying the journal over it rebuilds the buffer
+    being saved.  The journal stays until a save of the file succeeds,
+    so it is removed only if the user declines or it no longer fits.
+***/
+static bool _recoverSave( const char *fn ) {
+
+  char *path = _savePath( fn );
+  char *txt = NULL, msgBuffer[ 128 ];
+  int fd, count = 0;
+  size_t len, valid = 0;
+  jhead_t head;
+  bool okP = false;
+
+  if(( fd = open( path, O_RDONLY )) == -1 ) {
+    free( path );
+    return false;
+  }
+
+  if(( txt = _readJournal( fd, &len )) != NULL && len >= sizeof( jhead_t )) {
+
+    memcpy( &head, txt, sizeof( jhead_t ));
+
+    /* Same File, Its Size and Time Changed by the Rewrite */
+    if( memcmp( head.magic, JMAGIC, 4 ) == 0 && head.from > 0 &&
+	JOURNAL.head.existsP                                  &&
+	head.dev == JOURNAL.head.dev                          &&
+	head.ino == JOURNAL.head.ino                          &&
+	JOURNAL.head.size >= head.from )
+      valid = _validRecords( txt + sizeof( jhead_t ), len - sizeof( jhead_t ), &count );
+
+    snprintf( msgBuffer, 128, "Save of %s was interrupted. Finish it? [Y/N] ", fn );
+
+    if( count > 0 && miniBufferGetYN( msgBuffer ) &&
+	_replay( txt + sizeof( jhead_t ), valid ) == valid ) {
+      setStatusFlagModified();
+      miniBufferMessage( "Recovered the interrupted save, save again to finish it" );
+      okP = true;
+    }
+  }
+
+  free( txt );
+  close( fd );
+
+  if( !okP )
+    unlink( path );
+  free( path );
+
+  return okP;
+}
+
+
+/*****************************************************************************************
+				   BACKGROUND COMPACTION
+*****************************************************************************************/
+
+/* Checkpoint Being Written */
+typedef struct {
+  int     fd;
+  int     row;				     /* Rows Written */
+  size_t  part;				     /* Bytes of a Chunked Row Written */
+  int64_t runOff;			     /* Pending Run of File Text */
+  int64_t runLen;
+  bool    textP;			     /* No Runs, Every Row as Text */
+  size_t  used;				     /* Bytes in buf */
+  char    buf[ JBATCH ];
+} ckpt_t;
+
+/* Add a Record to the Checkpoint */
+static bool _ckptRecord( ckpt_t *c, enum _jop op, int64_t row, int64_t arg,
+			 const char *txt, size_t len ) {
+
+  jrec_t rec = { op, len, row, arg, 0, 0 };
+
+  rec.sum = _sum( &rec, txt );
+
+  if( c->used + sizeof( jrec_t ) + len > JBATCH ) {
+    if( !_writeAll( c->fd, c->buf, c->used )) return false;
+    c->used = 0;
+  }
+
+  /* Long Lines Go Straight Out */
+  if( sizeof( jrec_t ) + len > JBATCH )
+    return _writeAll( c->fd, (char *)&rec, sizeof( jrec_t )) && _writeAll( c->fd, txt, len );
+
+  memcpy( c->buf + c->used, &rec, sizeof( jrec_t ));
+  memcpy( c->buf + c->used + sizeof( jrec_t ), txt, len );
+  c->used += sizeof( jrec_t ) + len;
+
+  return true;
+}
+
+static bool _ckptRun( ckpt_t *c ) {
+
+  bool okP = true;
+
+  if( c->runLen > 0 )
+    okP = _ckptRecord( c, JRUN, c->runOff, c->runLen, NULL, 0 );
+
+  c->runLen = 0;
+  return okP;
+}
+
+/* Unedited File Lines Join a Run, Others Are Written Out */
+static bool _ckptRow( const char *txt, row_t r, void *arg ) {
+
+  ckpt_t *c = arg;
+  bool okP;
+
+  /* Chunked Rows Are Inserted, Then Spliced On a Chunk at a Time */
+  if( c->part > 0 || r.src == CHUNKTEXT ) {
+
+    if( c->part == 0 )
+      okP = _ckptRun( c ) && _ckptRecord( c, JINSERT, c->row, 0, txt, r.len );
+    else
+      okP = _ckptRecord( c, JSPLICE, c->row, _gap( c->part, c->part ), txt, r.len );
+
+    c->part += r.len;
+    if( r.src != CHUNKTEXT ) {
+      c->part = 0;
+      c->row++;
+    }
+
+    return okP;
+  }
+
+  if( r.src == ORIGTEXT && !c->textP ) {
+    if( c->runLen > 0 && c->runOff + c->runLen == (int64_t)r.off )
+      c->runLen += r.len;
+    else {
+      if( !_ckptRun( c )) return false;
+      c->runOff = r.off;
+      c->runLen = r.len;
+    }
+  }
+  else if( !_ckptRun( c ) || !_ckptRecord( c, JINSERT, c->row, 0, txt, r.len ))
+    return false;
+
+  c->row++;
+  return true;
+}
+
+/* Compaction Thread Body */
+static void *_compactWriter( void *arg ) {
+
+  ckpt_t *c;
+  bool okP;
+
+  (void)arg;
+
+  if(( c = malloc( sizeof( ckpt_t ))) == NULL )
+    die( "_compactWriter: malloc failed" );
+
+  c->fd   = COMPACT.fd;
+  c->row  = 0;
+  c->part = 0;
+  c->used = 0;
+  c->runLen = 0;
+  c->textP  = false;
+
+  okP = _writeAll( c->fd, (char *)&JOURNAL.head, sizeof( jhead_t )) &&
+    _ckptRecord( c, JCLEAR, 0, 0, NULL, 0 )                         &&
+    walkBufferSnap( COMPACT.snap, 0, _ckptRow, c )                  &&
+    _ckptRun( c )                                                   &&
+    _writeAll( c->fd, c->buf, c->used )                             &&
+    fdatasync( c->fd ) == 0;
+
+  free( c );
+
+  pthread_mutex_lock( &COMPACT.lock );
+  COMPACT.okP  = okP;
+  COMPACT.doneP = true;
+  pthread_mutex_unlock( &COMPACT.lock );
+
+  return NULL;
+}
+
+/* Snapshot the Buffer and Start a Checkpoint */
+static void _startCompact( void ) {
+
+  _flushJournal( false );
+  if( JOURNAL.path == NULL )
+    return;
+
+  if(( COMPACT.tmp = malloc( strlen( JOURNAL.path ) + 5 )) == NULL )
+    die( "_startCompact: malloc failed" );
+  sprintf( COMPACT.tmp, "%s.new", JOURNAL.path );
+
+  if(( COMPACT.fd = open( COMPACT.tmp, O_WRONLY | O_CREAT | O_TRUNC, 0600 )) == -1 ) {
+    free( COMPACT.tmp );
+    JOURNAL.baseP = false;		     /* Don't Keep Trying */
+    return;
+  }
+
+  COMPACT.snap    = snapBuffer();
+  COMPACT.mark    = JOURNAL.size;
+  COMPACT.epoch   = JOURNAL.epoch;
+  COMPACT.doneP   = false;
+  COMPACT.activeP = true;
+
+  COMPACT.threadP = ( pthread_create( &COMPACT.thread, NULL, _compactWriter, NULL ) == 0 );
+  if( !COMPACT.threadP )
+    _compactWriter( NULL );
+}
+
+/* Copy Journal Bytes From mark On to fd */
+static bool _copyTail( int fd, size_t mark ) {
+
+  char buf[ 1 << 14 ];
+  ssize_t n;
+
+  while( mark < JOURNAL.size ) {
+    if(( n = pread( JOURNAL.fd, buf, sizeof( buf ), mark )) <= 0 ) {
+      if( n == -1 && errno == EINTR ) continue;
+      return false;
+    }
+    if( !_writeAll( fd, buf, n )) return false;
+    mark += n;
+  }
+
+  return true;
+}
+
+/* Swap In the Checkpoint, Unless the Journal Moved On Without It */
+static void _endCompact( void ) {
+
+  off_t size = 0;
+
+  if( COMPACT.threadP )
+    pthread_join( COMPACT.thread, NULL );
+
+  releaseBufferSnap( COMPACT.snap );
+  COMPACT.activeP = COMPACT.threadP = false;
+
+  _flushJournal( false );
+
+  if( COMPACT.okP && COMPACT.epoch == JOURNAL.epoch && JOURNAL.path &&
+      _copyTail( COMPACT.fd, COMPACT.mark )                          &&
+      fdatasync( COMPACT.fd ) == 0                                   &&
+      ( size = lseek( COMPACT.fd, 0, SEEK_END )) != -1               &&
+      fcntl( COMPACT.fd, F_SETFL, O_APPEND ) != -1                   &&
+      rename( COMPACT.tmp, JOURNAL.path ) == 0 ) {
+
+    close( JOURNAL.fd );
+    JOURNAL.fd        = COMPACT.fd;
+    JOURNAL.size      = size;
+    JOURNAL.compacted = size;
+    JOURNAL.dirtyP    = false;
+  }
+  else {
+    close( COMPACT.fd );
+    unlink( COMPACT.tmp );
+  }
+
+  free( COMPACT.tmp );
+}
+
+/* Wait For a Running Compaction */
+static void _finishCompact( void ) {
+
+  if( COMPACT.activeP )
+    _endCompact();
+}
+
+
+/*****************************************************************************************
+				    IN-PLACE SAVES
+*****************************************************************************************/
+
+/***
+    Journal an In-Place Save of fn Before It Starts
+
+    Rewriting fn from byte from on leaves neither version whole if the
+    save stops part way.  FILE.aej.save holds the head as a run of file
+    text and every row of snap from fromRow on as text, so replaying it
+    reads nothing of fn past from.  The header goes in last, once the
+    records are synced, so a journal cut short is never offered.  Called
+    from the save writer, false with errno set if it can't be written.
+***/
+bool openSaveJournal( const char *fn, uint64_t from, bufferSnap_t *snap, int fromRow ) {
+
+  char *path = _savePath( fn );
+  jhead_t head, none;
+  ckpt_t *c;
+  bool okP;
+  int err;
+
+  _identify( fn, &head );
+  head.from = from;
+  memset( &none, 0, sizeof( jhead_t ));
+
+  if(( c = malloc( sizeof( ckpt_t ))) == NULL )
+    die( "openSaveJournal: malloc failed" );
+
+  c->row    = fromRow;
+  c->part   = 0;
+  c->used   = 0;
+  c->runLen = 0;
+  c->textP  = true;
+
+  okP = ( c->fd = open( path, O_WRONLY | O_CREAT | O_TRUNC, 0600 )) != -1 &&
+    _writeAll( c->fd, (char *)&none, sizeof( jhead_t ))                   &&
+    _ckptRecord( c, JCLEAR, 0, 0, NULL, 0 )                                &&
+    _ckptRecord( c, JRUN, 0, from, NULL, 0 )                               &&
+    walkBufferSnap( snap, fromRow, _ckptRow, c )                           &&
+    _writeAll( c->fd, c->buf, c->used )                                    &&
+    fdatasync( c->fd ) == 0                                                &&
+    pwrite( c->fd, &head, sizeof( jhead_t ), 0 ) == (ssize_t)sizeof( jhead_t ) &&
+    fdatasync( c->fd ) == 0;
+
+  err = errno;
+  if( c->fd != -1 )
+    close( c->fd );
+  if( !okP )
+    unlink( path );
+
+  free( c );
+  free( path );
+
+  errno = err;
+  return okP;
+}
+
+/* The Save Finished, or fn Was Written Whole */
+void closeSaveJournal( const char *fn ) {
+
+  char *path = _savePath( fn );
+
+  unlink( path );
+  free( path );
+}
+
+
+/*****************************************************************************************
+				    JOURNAL MANAGEMENT
+*****************************************************************************************/
+
+/* Start Journaling Edits to fn, Offering Edits a Crash Left Behind */
+void openJournal( const char *fn ) {
+
+  closeJournal();
+
+  if(( JOURNAL.path = malloc( strlen( fn ) + 5 )) == NULL )
+    die( "openJournal: malloc failed" );
+  sprintf( JOURNAL.path, "%s.aej", fn );
+
+  _identify( fn, &JOURNAL.head );
+
+  JOURNAL.fd     = -1;
+  JOURNAL.size   = 0;
+  JOURNAL.compacted = 0;
+  JOURNAL.used   = 0;
+  JOURNAL.dirtyP = false;
+  JOURNAL.baseP  = true;
+  JOURNAL.synced = _now();
+
+  if( !_recoverSave( fn ))
+    _recover();
+}
+
+/* Stop Journaling, the Buffer's Edits Were Saved or Dropped */
+void closeJournal( void ) {
+
+  _finishCompact();
+
+  if( JOURNAL.fd != -1 )
+    close( JOURNAL.fd );
+
+  if( JOURNAL.path && JOURNAL.fd != -1 )
+    unlink( JOURNAL.path );
+
+  free( JOURNAL.path );
+  JOURNAL.path = NULL;
+  JOURNAL.fd   = -1;
+  JOURNAL.used = 0;
+  JOURNAL.epoch++;
+}
+
+/* Journal Length, Written or Not */
+size_t markJournal( void ) {
+
+  return ( JOURNAL.fd == -1 ? sizeof( jhead_t ) : JOURNAL.size ) + JOURNAL.used;
+}
+
+/***
+    Rebase the Journal on a Saved File
+
+    fn now holds the buffer as it was when the journal was mark bytes
+    long.  The records after mark are moved to a new journal for fn.
+***/
+void rebaseJournal( const char *fn, size_t mark ) {
+
+  int fd = -1;
+  char *path, *tmp;
+
+  if( JOURNAL.path == NULL )
+    return;
+
+  _finishCompact();
+  _flushJournal( false );
+  if( JOURNAL.path == NULL )
+    return;
+
+  if(( path = malloc( strlen( fn ) + 5 )) == NULL ||
+     ( tmp  = malloc( strlen( fn ) + 9 )) == NULL )
+    die( "rebaseJournal: malloc failed" );
+  sprintf( path, "%s.aej", fn );
+  sprintf( tmp, "%s.new", path );
+
+  _identify( fn, &JOURNAL.head );
+  JOURNAL.baseP = false;
+  JOURNAL.epoch++;
+
+  /* Nothing Since the Save, Start Over on the Next Edit */
+  if( JOURNAL.fd == -1 || mark >= JOURNAL.size ) {
+    if( JOURNAL.fd != -1 ) {
+      close( JOURNAL.fd );
+      unlink( JOURNAL.path );
+    }
+    JOURNAL.fd     = -1;
+    JOURNAL.size   = 0;
+    JOURNAL.dirtyP = false;
+  }
+
+  /* Carry Later Records Over */
+  else if(( fd = open( tmp, O_WRONLY | O_CREAT | O_TRUNC, 0600 )) != -1 &&
+	   _writeAll( fd, (char *)&JOURNAL.head, sizeof( jhead_t ))  &&
+	   _copyTail( fd, mark )                                     &&
+	   fdatasync( fd ) == 0                                      &&
+	   fcntl( fd, F_SETFL, O_APPEND ) != -1                      &&
+	   rename( tmp, path ) == 0 ) {
+
+    close( JOURNAL.fd );
+    if( strcmp( path, JOURNAL.path ) != 0 )
+      unlink( JOURNAL.path );
+
+    JOURNAL.size   = sizeof( jhead_t ) + JOURNAL.size - mark;
+    JOURNAL.fd     = fd;
+    JOURNAL.dirtyP = false;
+  }
+  else {
+    if( fd != -1 ) {
+      close( fd );
+      unlink( tmp );
+    }
+    _journalFailed();
+  }
+
+  free( tmp );
+
+  /* Journal Now Follows fn */
+  if( JOURNAL.path ) {
+    free( JOURNAL.path );
+    JOURNAL.path = path;
+  }
+  else
+    free( path );
+}
+
+/* Sync Gathered Records and Run Compaction, Called While Waiting for Keys */
+void pollJournal( void ) {
+
+  bool doneP;
+
+  if( COMPACT.activeP ) {
+    pthread_mutex_lock( &COMPACT.lock );
+    doneP = COMPACT.doneP;
+    pthread_mutex_unlock( &COMPACT.lock );
+    if( doneP )
+      _endCompact();
+  }
+
+  if( JOURNAL.path == NULL )
+    return;
+
+  if(( JOURNAL.used > 0 || JOURNAL.dirtyP ) && _now() - JOURNAL.synced >= JSYNCSECS )
+    _flushJournal( true );
+
+  if( !COMPACT.activeP && JOURNAL.baseP &&
+      JOURNAL.size >= JCOMPACT && JOURNAL.size >= 2 * JOURNAL.compacted )
+    _startCompact();
+}
+
+
+/***
+    Local Variables:
+    mode: c
+    tags-file-name: "~/ae/TAGS"
+    comment-column: 45
+    fill-column: 90
+    End:
+ ***/
@@ -0,0 +1,16 @@
+/* Edit Journal */
+void openJournal( const char * );
+void closeJournal( void );
+size_t markJournal( void );
+void rebaseJournal( const char *, size_t );
+void pollJournal( void );
+
+/* In-Place Saves */
+bool openSaveJournal( const char *, uint64_t, bufferSnap_t *, int );
+void closeSaveJournal( const char * );
+
+/* Buffer Hooks */
+void journalSetRow( int, const char *, size_t );
+void journalInsertRow( int, const char *, size_t );
+void journalDeleteRows( int, int );
+void journalSpliceRow( int, int, int, const char *, size_t );
@@ -38,6 +38,8 @@
 #include "state.h"
 #include "edit.h"
 #include "buffer.h"
+#include "journal.h"
+#include "undo.h"
 #include "window.h"
 #include "keyPress.h"
 
@@ -61,6 +63,9 @@ int readKey() {
   while(( c = wgetch( getWindowHandle() )) == ERR ) {
 
     /* Handle Timeouts */
+    pollBufferSave();
+    pollJournal();
+    trimBufferMemory();
     refresh();
   }
   
@@ -68,16 +73,98 @@ int readKey() {
 }
 
 
+/* Refuse Edits to a Read-Only Buffer */
+static bool _readOnlyP( void ) {
+
+  if( !statusFlagReadOnlyP() ) return false;
+
+  miniBufferMessage( "Buffer is read-only" );
+  return true;
+}
+
+/* Keys That Change the Buffer Text */
+static bool _editKeyP( int c ) {
+
+  switch(c) {
+  case '\t':
+  case '\r':
+  case CTRL_KEY('d'):
+  case KEY_DC:
+  case CTRL_KEY('h'):
+  case KEY_BACKSPACE:
+  case CTRL_KEY('k'):
+  case CTRL_KEY('y'):
+  case CTRL_KEY('w'):
+  case CTRL_KEY('_'):
+  case KEY_F(5):
+  case KEY_F(6):
+    return true;
+  }
+
+  return ( c < KEY_MIN && isprint( c ));
+}
+
+/***
+    Universal Argument
+
+    Counted commands do their work once: moving n lines or chars is one
+    jump, killing n lines one range delete, and inserting n copies of a
+    char one splice.  Other keys are repeated.
+***/
 void _universalArgument( void ) {
 
   int times = miniBufferGetUniversalArg();
   int c     = miniBufferGetUniversalChr();
 
-  if( c == CTRL_KEY('g') )
+  if( c == CTRL_KEY('g') || times <= 0 )
     return;
-  
-  while( times-- > 0 ) {
-    _handleKeypress( c );
+
+  if( _editKeyP( c ) && _readOnlyP() )
+    return;
+
+  switch(c) {
+
+  case CTRL_KEY('n'):			     /* Next n Lines */
+  case KEY_DOWN:
+    updateNavigationState();
+    moveLines( times );
+    break;
+
+  case CTRL_KEY('p'):			     /* Prior n Lines */
+  case KEY_UP:
+    updateNavigationState();
+    moveLines( -times );
+    break;
+
+  case CTRL_KEY('f'):			     /* Forward n Chars */
+  case KEY_RIGHT:
+    updateNavigationState();
+    moveChars( times );
+    break;
+
+  case CTRL_KEY('b'):			     /* Back n Chars */
+  case KEY_LEFT:
+    updateNavigationState();
+    moveChars( -times );
+    break;
+
+  case CTRL_KEY('k'):			     /* Kill n Lines */
+    killLines( times );
+    updateNavigationState();
+    miniBufferMessage( "Killed Text" );
+    break;
+
+  case '\r':				     /* n Newlines */
+    insertCopies( '\n', times );
+    break;
+
+  default:
+    if( c < KEY_MIN && isprint( c ))	     /* n Copies */
+      insertCopies( c, times );
+    else
+      while( times-- > 0 )
+	_handleKeypress( c );
+    break;
   }
 }
 
@@ -123,6 +210,7 @@ static void _eXtensionMenu( void ) {
   switch(c) {
 
   case CTRL_KEY('c'):			     /* Close Editor */
+    finishBufferSave();			     /* Settle the Status Flag */
     if( statusFlagModifiedP() )
       if( miniBufferGetYN( "Buffer Modified. Save? [Y/N] " )) {
 	updateNavigationState();
@@ -133,7 +221,13 @@ static void _eXtensionMenu( void ) {
     exit(EXIT_SUCCESS);
     break;
 
+  case 'j':				     /* Jump to Byte Offset */
+    updateNavigationState();
+    jumpToByte();
+    break;
+
   case 'k':				     /* Kill Buffer */
+    finishBufferSave();			     /* Settle the Status Flag */
     if( statusFlagModifiedP() )
       if( miniBufferGetYN( "Buffer Modified. Save? [Y/N] " )) {
 	updateNavigationState();
@@ -142,7 +236,17 @@ static void _eXtensionMenu( void ) {
     killBuffer();
     break;
 
+  case 'm':				     /* Memory Report */
+    reportBufferMemory();
+    break;
+
+  case 'p':				     /* Jump to Percent */
+    updateNavigationState();
+    jumpToPercent();
+    break;
+
   case 'r':				     /* Rectangle Operations */
+    if( _readOnlyP() ) break;
     _rectangleMenu();
     break;
     
@@ -159,6 +263,7 @@ static void _eXtensionMenu( void ) {
   case CTRL_KEY('f'):			     /* Open Buffer File */
   case CTRL_KEY('v'):
     /* Close Old Buffer */
+    finishBufferSave();			     /* Settle the Status Flag */
     if( statusFlagModifiedP() )
       if( miniBufferGetYN( "Buffer Modified. Save? [Y/N] " )) {
 	updateNavigationState();
@@ -169,6 +274,18 @@ static void _eXtensionMenu( void ) {
     if( openFile() )
       readBufferFile( getBufferFilename() );
     break;
+
+  case CTRL_KEY('r'):			     /* View Buffer File Read-Only */
+    finishBufferSave();			     /* Settle the Status Flag */
+    if( statusFlagModifiedP() )
+      if( miniBufferGetYN( "Buffer Modified. Save? [Y/N] " )) {
+	updateNavigationState();
+	saveBuffer();
+      }
+    killBuffer();
+    if( openFile() )
+      viewBufferFile( getBufferFilename() );
+    break;
     
   case CTRL_KEY('w'):                /* Save Buffer As */
     if( statusFlagModifiedP() ) {
@@ -214,10 +331,12 @@ void metaMenu( void ) {
     break;
 
   case 'c':				     /* Capitalize Word */
+    if( _readOnlyP() ) break;
     capitalizeWord();
     break;
 
   case 'd':				     /* Kill Forward Word */
+    if( _readOnlyP() ) break;
     killWord();
     updateEditState();
     break;
@@ -227,13 +346,31 @@ void metaMenu( void ) {
     break;
 
   case 'l':				     /* Downcase Word */
+    if( _readOnlyP() ) break;
     downcaseWord();
     break;
     
   case 'u':				     /* Upcase Word */
+    if( _readOnlyP() ) break;
     upcaseWord();
     break;
+
+  case 'w':				     /* Copy Region */
+    if( _readOnlyP() ) break;
+    updateNavigationState();
+    copyRegion();
+    break;
+
+  case 'y':				     /* Yank Pop */
+    if( _readOnlyP() ) break;
+    yankPop();
+    break;
     
+  case '_':				     /* Redo */
+    if( _readOnlyP() ) break;
+    redoEdit();
+    break;
+
   case 'v':				     /* Backward Page */
     updateNavigationState();
     pageUp();
@@ -261,6 +398,9 @@ void metaMenu( void ) {
 /* Process Keypresses */
 static void _handleKeypress( int c ) {
 
+  if( _editKeyP( c ) && _readOnlyP() )
+    return;
+
   switch(c) {
     
     /* Meta Key */
@@ -297,6 +437,7 @@ static void _handleKeypress( int c ) {
   case KEY_F(2):			     /* Find File */
     
     /* Close Old Buffer */
+    finishBufferSave();			     /* Settle the Status Flag */
     if( statusFlagModifiedP() )
       if( miniBufferGetYN( "Buffer Modified. Save? [Y/N] " )) {
 	updateNavigationState();
@@ -308,8 +449,18 @@ static void _handleKeypress( int c ) {
       readBufferFile( getBufferFilename() );
     break;
 
+
+  case KEY_F(5):			     /* Undo */
+  case CTRL_KEY('_'):
+    undoEdit();
+    break;
+
+  case KEY_F(6):			     /* Redo */
+    redoEdit();
+    break;
     
   case KEY_F(10):			     /* Exit */
+    finishBufferSave();			     /* Let a Running Save Finish */
     closeEditor();
     exit(EXIT_SUCCESS);
     break;
@@ -441,6 +592,7 @@ static void _handleKeypress( int c ) {
 
 void processKeypress( void ) {
 
+  undoBoundary();			     /* Each Command Undoes as a Step */
   _handleKeypress( readKey() );    
 }
 
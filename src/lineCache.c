@@ -0,0 +1,461 @@
+/***
+==========================================================================================
+                      _              _         _____    _ _ _
+                     / \   _ __   __| |_   _  | ____|__| (_) |_
+                    / _ \ | '_ \ / _` | | | | |  _| / _` | | __|
+                   / ___ \| | | | (_| | |_| | | |__| (_| | | |_
+                  /_/   \_\_| |_|\__,_|\__, | |_____\__,_|_|\__|  v0.5-beta
+                                       |___/
+
+        Copyright 2020 (andrew.suttles@gmail.com)
+        MIT LICENSE
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+ INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE 
+ LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT 
+ OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ DEALINGS IN THE SOFTWARE.
+
+ AndyEDIT is a simple, line-oriented, terminal-based text editor with emacs-like keybindings.
+
+ For more information about AndyEdit, see README.md.
+
+==========================================================================================
+ ***/
+#define _XOPEN_SOURCE 700		     /* realpath(), mkstemp() are X/Open */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "ae.h"
+#include "lineScan.h"
+#include "lineCache.h"
+
+/***
+    Line Index Cache
+
+    Indexing a big file reads every byte of it.  After a scan the file's
+    line ends are written to a cache file in $AE_CACHE (default
+    $XDG_CACHE_HOME/ae, or ~/.cache/ae), named by a hash of the file's
+    full path.  The cache header records the path, device, inode, size
+    and modification time of the file indexed, and a hash of the text
+    before its last line end.
+
+    Opening the same file again maps the cache and hands its rows to the
+    buffer without reading the file.  The cache is checked against the
+    text only at the last line end and a few sampled ones.  A file that
+    grew, keeping its inode and the text hashed, is scanned from the
+    last cached line end on, and the new line ends are appended to the
+    cache.  Any other change is a miss, and the file is scanned again.
+***/
+
+/* Module Constants */
+#define CMAGIC   "AEINDEX1"
+#define CACHEMIN (1 << 24)		     /* Cache Files From 16 MB */
+#define CSUMLEN  4096			     /* Text Hashed Before the Last Line End */
+#define CSAMPLES 64			     /* Line Ends Checked Against the Text */
+#define CBATCH   8192			     /* Line Ends Gathered per write */
+
+/* Cache Header, the Path and Line Ends Follow */
+typedef struct {
+  char     magic[8];
+  uint64_t dev;
+  uint64_t ino;
+  uint64_t size;			     /* File Bytes Indexed */
+  int64_t  mtime;
+  int64_t  mtimeNs;
+  uint64_t lines;			     /* Line Ends in the Cache */
+  uint64_t sum;				     /* Hash of Text Before the Last End */
+  uint64_t pathLen;			     /* Path, Padded to 8 Bytes */
+} chead_t;
+
+/* Module Private Data */
+static struct {
+  void (*addRow)( size_t, size_t );	     /* Buffer's Row Callback */
+  const char *txt;			     /* File Text */
+  size_t   base;			     /* Offset of Text Being Scanned */
+  int      fd;				     /* Cache Being Written, -1 If None */
+  off_t    at;				     /* Offset of Next Line End */
+  uint64_t ends[CBATCH];		     /* Line Ends Not Yet Written */
+  size_t   n;
+  uint64_t lines;			     /* Line Ends in the Cache */
+  uint64_t last;			     /* Last Line End */
+  bool     okP;				     /* No Write Failed */
+  size_t   reused;			     /* File Bytes Indexed by the Cache */
+  double   secs;			     /* Time of Last Index */
+} CACHE = { .fd = -1 };
+
+
+/*****************************************************************************************
+				      CACHE FILES
+*****************************************************************************************/
+
+/* Seconds on the Monotonic Clock */
+static double _now( void ) {
+
+  struct timespec ts;
+
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* FNV-1a Hash of len Bytes */
+static uint64_t _hash( const char *txt, size_t len ) {
+
+  uint64_t h = 14695981039346656037ULL;
+
+  while( len-- ) {
+    h ^= (unsigned char)*txt++;
+    h *= 1099511628211ULL;
+  }
+
+  return h;
+}
+
+/* Path Bytes, Padded to 8 */
+static size_t _padded( size_t len ) {
+
+  return ( len + 7 ) & ~(size_t)7;
+}
+
+/* Hash of the Text Before a Line End */
+static uint64_t _endSum( const char *txt, uint64_t end ) {
+
+  size_t n = end < CSUMLEN ? end : CSUMLEN;
+
+  return _hash( txt + end - n, n );
+}
+
+/* Make the Cache Directory, False If Caching is Off */
+static bool _cacheDir( char *dir, size_t max ) {
+
+  char *env;
+  int n;
+
+  if(( env = getenv( "AE_CACHE" )) != NULL ) {
+    if( *env == '\0' || strcmp( env, "0" ) == 0 || strcmp( env, "off" ) == 0 )
+      return false;
+    n = snprintf( dir, max, "%s", env );
+  }
+  else if(( env = getenv( "XDG_CACHE_HOME" )) != NULL && *env != '\0' ) {
+    n = snprintf( dir, max, "%s", env );
+    if( n > 0 && (size_t)n < max ) mkdir( dir, 0700 );
+    n = snprintf( dir, max, "%s/ae", env );
+  }
+  else if(( env = getenv( "HOME" )) != NULL && *env != '\0' ) {
+    n = snprintf( dir, max, "%s/.cache", env );
+    if( n > 0 && (size_t)n < max ) mkdir( dir, 0700 );
+    n = snprintf( dir, max, "%s/.cache/ae", env );
+  }
+  else
+    return false;
+
+  if( n <= 0 || (size_t)n >= max )
+    return false;
+
+  return ( mkdir( dir, 0700 ) == 0 || errno == EEXIST );
+}
+
+/* Cache File for fn, Named by Its Full Path */
+static bool _cachePath( const char *fn, char **real, char **path ) {
+
+  char dir[ 4096 ];
+
+  if( !_cacheDir( dir, sizeof( dir )))
+    return false;
+
+  if(( *real = realpath( fn, NULL )) == NULL )
+    return false;
+
+  if(( *path = malloc( strlen( dir ) + 22 )) == NULL )
+    die( "lineCache: malloc failed" );
+
+  sprintf( *path, "%s/%016llx.aei", dir,
+	   (unsigned long long)_hash( *real, strlen( *real )));
+
+  return true;
+}
+
+/* Map the Cache, NULL Unless It Indexes a Prefix of txt */
+static const uint64_t *_mapCache( const char *path, const char *real,
+				  const struct stat *sb, const char *txt, size_t len,
+				  void **map, size_t *mapLen, chead_t *h ) {
+
+  int fd, i;
+  struct stat cb;
+  size_t body;
+  const uint64_t *ends;
+  uint64_t at, prev;
+
+  *map = MAP_FAILED;
+
+  if(( fd = open( path, O_RDONLY )) == -1 )
+    return NULL;
+
+  if( fstat( fd, &cb ) == -1 || (size_t)cb.st_size < sizeof( chead_t )) {
+    close( fd );
+    return NULL;
+  }
+
+  *mapLen = cb.st_size;
+  *map = mmap( NULL, *mapLen, PROT_READ, MAP_SHARED, fd, 0 );
+  close( fd );
+
+  if( *map == MAP_FAILED )
+    return NULL;
+
+  memcpy( h, *map, sizeof( chead_t ));
+  body = sizeof( chead_t ) + _padded( strlen( real ));
+  ends = (const uint64_t *)((char *)*map + body );
+
+  /* Same File, Unchanged or Grown */
+  if( memcmp( h->magic, CMAGIC, 8 ) != 0 ||
+      h->dev != (uint64_t)sb->st_dev ||
+      h->ino != (uint64_t)sb->st_ino ||
+      h->pathLen != strlen( real ) ||
+      *mapLen < body ||
+      memcmp( (char *)*map + sizeof( chead_t ), real, h->pathLen ) != 0 ||
+      h->lines == 0 ||
+      h->lines > ( *mapLen - body ) / sizeof( uint64_t ) ||
+      h->size > len ||
+      ( h->size == len && ( h->mtime   != (int64_t)sb->st_mtim.tv_sec ||
+			    h->mtimeNs != (int64_t)sb->st_mtim.tv_nsec )))
+    goto miss;
+
+  /* Text Before the Last Line End Unchanged */
+  at = ends[ h->lines - 1 ];
+  if( at == 0 || at > h->size || txt[ at - 1 ] != '\n' || _endSum( txt, at ) != h->sum )
+    goto miss;
+
+  /* Sampled Line Ends Still End Lines */
+  for( prev = 0, i = 0; i<CSAMPLES; i++ ) {
+    at = ends[ ( h->lines - 1 ) * i / ( CSAMPLES - 1 ) ];
+    if( at < prev || at == 0 || txt[ at - 1 ] != '\n' )
+      goto miss;
+    prev = at;
+  }
+
+  return ends;
+
+ miss:
+  munmap( *map, *mapLen );
+  *map = MAP_FAILED;
+  return NULL;
+}
+
+
+/*****************************************************************************************
+				     WRITING CACHES
+*****************************************************************************************/
+
+/* Write Gathered Line Ends */
+static void _flushEnds( void ) {
+
+  size_t len = CACHE.n * sizeof( uint64_t );
+
+  if( CACHE.okP && CACHE.n > 0 &&
+      pwrite( CACHE.fd, CACHE.ends, len, CACHE.at ) != (ssize_t)len )
+    CACHE.okP = false;
+
+  CACHE.at += len;
+  CACHE.n   = 0;
+}
+
+/* Gather a Line End */
+static void _pushEnd( uint64_t end ) {
+
+  if( CACHE.n == CBATCH )
+    _flushEnds();
+
+  CACHE.ends[ CACHE.n++ ] = end;
+  CACHE.lines++;
+  CACHE.last = end;
+}
+
+/* Row Found Scanning, Hand It On and Cache Its End */
+static void _cachedRow( size_t off, size_t len ) {
+
+  off += CACHE.base;
+  CACHE.addRow( off, len );
+
+  if( CACHE.fd != -1 && len > 0 && CACHE.txt[ off + len - 1 ] == '\n' )
+    _pushEnd( off + len );
+}
+
+/* Start a New Cache, Written Beside path Then Renamed */
+static char *_newCache( const char *path, const char *real ) {
+
+  static const char zero[ 8 ];
+  chead_t h;
+  size_t pathLen = strlen( real );
+  char *tmp;
+
+  if(( tmp = malloc( strlen( path ) + 8 )) == NULL )
+    die( "lineCache: malloc failed" );
+  sprintf( tmp, "%s.XXXXXX", path );
+
+  if(( CACHE.fd = mkstemp( tmp )) == -1 ) {
+    free( tmp );
+    return NULL;
+  }
+
+  memset( &h, 0, sizeof( chead_t ));
+  CACHE.okP = ( write( CACHE.fd, &h, sizeof( chead_t )) == sizeof( chead_t ) &&
+		write( CACHE.fd, real, pathLen ) == (ssize_t)pathLen &&
+		write( CACHE.fd, zero, _padded( pathLen ) - pathLen ) ==
+		(ssize_t)( _padded( pathLen ) - pathLen ));
+  CACHE.at    = sizeof( chead_t ) + _padded( pathLen );
+  CACHE.lines = 0;
+  CACHE.last  = 0;
+
+  return tmp;
+}
+
+/* Reopen a Cache to Append Line Ends of a Grown File */
+static bool _growCache( const char *path, const chead_t *h ) {
+
+  if(( CACHE.fd = open( path, O_WRONLY )) == -1 )
+    return false;
+
+  CACHE.okP   = true;
+  CACHE.at    = sizeof( chead_t ) + _padded( h->pathLen ) + h->lines * sizeof( uint64_t );
+  CACHE.lines = h->lines;
+  CACHE.last  = CACHE.reused;
+
+  return true;
+}
+
+/***
+    Finish the Cache
+
+    The header is written last, so a cache cut short still describes
+    only the line ends written before it.
+***/
+static void _endCache( const char *path, char *tmp, const char *real,
+		       const struct stat *sb, size_t len ) {
+
+  chead_t h;
+
+  _flushEnds();
+
+  memset( &h, 0, sizeof( chead_t ));
+  memcpy( h.magic, CMAGIC, 8 );
+  h.dev     = sb->st_dev;
+  h.ino     = sb->st_ino;
+  h.size    = len;
+  h.mtime   = sb->st_mtim.tv_sec;
+  h.mtimeNs = sb->st_mtim.tv_nsec;
+  h.lines   = CACHE.lines;
+  h.sum     = CACHE.lines > 0 ? _endSum( CACHE.txt, CACHE.last ) : 0;
+  h.pathLen = strlen( real );
+
+  if( CACHE.lines == 0 ||
+      pwrite( CACHE.fd, &h, sizeof( chead_t ), 0 ) != sizeof( chead_t ))
+    CACHE.okP = false;
+
+  close( CACHE.fd );
+  CACHE.fd = -1;
+
+  if( tmp ) {
+    if( !CACHE.okP || rename( tmp, path ) == -1 )
+      unlink( tmp );
+    free( tmp );
+  }
+}
+
+
+/*****************************************************************************************
+				     CACHED INDEXING
+*****************************************************************************************/
+
+/***
+    Find the Lines of fn's Text, Using Its Cache
+
+    Like scanLines(), addRow gets each line's offset and length,
+    including the '\n'.  sb is fn's status when txt was read.  Files
+    under CACHEMIN are always scanned.  Returns the number of lines.
+***/
+size_t scanCachedLines( const char *fn, const struct stat *sb, const char *txt, size_t len,
+			void (*addRow)( size_t, size_t )) {
+
+  double t0 = _now();
+  char *real = NULL, *path = NULL, *tmp = NULL;
+  const uint64_t *ends = NULL;
+  void *map = MAP_FAILED;
+  size_t mapLen = 0, lines = 0, i, from = 0;
+  chead_t h;
+
+  CACHE.addRow = addRow;
+  CACHE.txt    = txt;
+  CACHE.fd     = -1;
+  CACHE.n      = 0;
+  CACHE.reused = 0;
+
+  if( len >= CACHEMIN && _cachePath( fn, &real, &path ))
+    ends = _mapCache( path, real, sb, txt, len, &map, &mapLen, &h );
+
+  /* Rows Up to the Last Cached Line End */
+  if( ends ) {
+    for( i = 0; i<h.lines; i++ ) {
+      addRow( from, ends[i] - from );
+      from = ends[i];
+    }
+    lines = h.lines;
+    CACHE.reused = from;
+
+    /* Grown, Append the New Line Ends */
+    if( len > h.size )
+      _growCache( path, &h );
+  }
+  else if( path )
+    tmp = _newCache( path, real );
+
+  /* Scan the Text the Cache Doesn't Cover */
+  CACHE.base = from;
+  lines += scanLines( txt + from, len - from, _cachedRow );
+
+  if( CACHE.fd != -1 )
+    _endCache( path, tmp, real, sb, len );
+
+  if( map != MAP_FAILED )
+    munmap( map, mapLen );
+
+  free( real );
+  free( path );
+
+  CACHE.secs = _now() - t0;
+
+  return lines;
+}
+
+/* File Bytes Indexed From the Cache by the Last Scan */
+size_t getLineCacheReused( void ) {
+
+  return CACHE.reused;
+}
+
+/* Seconds Spent in the Last Scan, Cache Included */
+double getLineCacheSeconds( void ) {
+
+  return CACHE.secs;
+}
+
+
+/***
+    Local Variables:
+    mode: c
+    tags-file-name: "~/ae/TAGS"
+    comment-column: 45
+    fill-column: 90
+    End:
+ ***/
@@ -0,0 +1,5 @@
+/* Cached Newline Index */
+size_t scanCachedLines( const char *, const struct stat *, const char *, size_t,
+			void (*)( size_t, size_t ));
+size_t getLineCacheReused( void );
+double getLineCacheSeconds( void );
@@ -0,0 +1,314 @@
+/***
+==========================================================================================
+                      _              _         _____    _ _ _
+                     / \   _ __   __| |_   _  | ____|__| (_) |_
+                    / _ \ | '_ \ / _` | | | | |  _| / _` | | __|
+                   / ___ \| | | | (_| | |_| | | |__| (_| | | |_
+                  /_/   \_\_| |_|\__,_|\__, | |_____\__,_|_|\__|  v0.5-beta
+                                       |___/
+
+        Copyright 2020 (andrew.suttles@gmail.com)
+        MIT LICENSE
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+ INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE 
+ LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT 
+ OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ DEALINGS IN THE SOFTWARE.
+
+ AndyEDIT is a simple, line-oriented, terminal-based text editor with emacs-like keybindings.
+
+ For more information about AndyEdit, see README.md.
+
+==========================================================================================
+ ***/
+#define _POSIX_C_SOURCE 200809L		     /* clock_gettime() is POSIX */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "ae.h"
+#include "lineScan.h"
+
+/***
+    Parallel Newline Indexer
+
+    The text is split into one chunk per CPU.  Each chunk is scanned on
+    its own thread with SSE2 (or AVX2, when the CPU has it) compares for
+    '\n', building a table of line ends.  The chunk tables are then
+    merged, in order, into rows for the caller.
+***/
+
+/* Module Constants */
+#define MINCHUNK (1 << 20)		     /* Smallest Chunk Worth a Thread */
+#define MAXCHUNK 0xffffffffu		     /* Chunk Offsets Fit 32 Bits */
+#define MAXTHRDS 64			     /* Max Scanner Threads */
+
+/* Chunk of Text Being Scanned */
+typedef struct {
+  const char *txt;			     /* Start of Chunk */
+  size_t   len;				     /* Length of Chunk */
+  uint32_t *ends;			     /* Line Ends, Chunk Relative */
+  size_t   n;				     /* Line Ends Found */
+  size_t   size;			     /* Line Ends Reserved */
+} chunk_t;
+
+/* Module Private Data */
+static double SCANSECS  = 0.0;		     /* Time of Last Scan */
+static int    SCANTHRDS = 0;		     /* Threads Used in Last Scan */
+
+
+/*****************************************************************************************
+				       SCAN KERNELS
+*****************************************************************************************/
+
+/* Record a Line End */
+static void _pushEnd( chunk_t *ck, size_t end ) {
+
+  if( ck->n == ck->size ) {
+    ck->size = ck->size ? ck->size * 2 : 4096;
+    if(( ck->ends = realloc( ck->ends, ck->size * sizeof( uint32_t ))) == NULL )
+      die( "_pushEnd: realloc failed" );
+  }
+
+  ck->ends[ ck->n++ ] = (uint32_t)end;
+}
+
+/* Scan Bytes One at a Time */
+static void _scanBytes( chunk_t *ck, size_t from ) {
+
+  for( size_t i = from; i<ck->len; i++ ) {
+
+    if( ck->txt[i] == '\n' )
+      _pushEnd( ck, i + 1 );
+  }
+}
+
+#if defined(__SSE2__)
+
+/* Record Line Ends for a 64 Byte Block, nl is a Bit Mask */
+static void _scanMasks( chunk_t *ck, size_t base, uint64_t nl ) {
+
+  while( nl ) {
+    _pushEnd( ck, base + __builtin_ctzll( nl ) + 1 );
+    nl &= nl - 1;
+  }
+}
+
+/* Compare 16 Bytes Against c, One Bit Per Byte */
+static inline uint64_t _mask16( const char *p, __m128i c ) {
+
+  __m128i v = _mm_loadu_si128(( const __m128i * )p );
+
+  return (uint64_t)(uint16_t)_mm_movemask_epi8( _mm_cmpeq_epi8( v, c ));
+}
+
+/* SSE2 Kernel, 64 Bytes per Step */
+static void _scanSSE2( chunk_t *ck ) {
+
+  size_t i;
+  uint64_t nl;
+
+  __m128i cNL = _mm_set1_epi8( '\n' );
+
+  for( i = 0; i + 64 <= ck->len; i += 64 ) {
+
+    const char *p = ck->txt + i;
+
+    nl = _mask16( p, cNL )        | _mask16( p + 16, cNL ) << 16 |
+         _mask16( p + 32, cNL ) << 32 | _mask16( p + 48, cNL ) << 48;
+
+    if( nl )
+      _scanMasks( ck, i, nl );
+  }
+
+  _scanBytes( ck, i );
+}
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define HAVE_AVX2_KERNEL
+
+/* Compare 32 Bytes Against c, One Bit Per Byte */
+__attribute__(( target( "avx2" )))
+static inline uint64_t _mask32( const char *p, __m256i c ) {
+
+  __m256i v = _mm256_loadu_si256(( const __m256i * )p );
+
+  return (uint64_t)(uint32_t)_mm256_movemask_epi8( _mm256_cmpeq_epi8( v, c ));
+}
+
+/* AVX2 Kernel, 64 Bytes per Step */
+__attribute__(( target( "avx2" )))
+static void _scanAVX2( chunk_t *ck ) {
+
+  size_t i;
+  uint64_t nl;
+
+  __m256i cNL = _mm256_set1_epi8( '\n' );
+
+  for( i = 0; i + 64 <= ck->len; i += 64 ) {
+
+    const char *p = ck->txt + i;
+
+    nl = _mask32( p, cNL ) | _mask32( p + 32, cNL ) << 32;
+
+    if( nl )
+      _scanMasks( ck, i, nl );
+  }
+
+  _scanBytes( ck, i );
+}
+#endif
+
+#endif
+
+/* Thread Body: Scan One Chunk With the Best Kernel */
+static void *_scanChunk( void *arg ) {
+
+  chunk_t *ck = arg;
+
+#if defined(HAVE_AVX2_KERNEL)
+  if( __builtin_cpu_supports( "avx2" )) {
+    _scanAVX2( ck );
+    return NULL;
+  }
+#endif
+
+#if defined(__SSE2__)
+  _scanSSE2( ck );
+#else
+  _scanBytes( ck, 0 );
+#endif
+
+  return NULL;
+}
+
+
+/*****************************************************************************************
+				   SCAN AND MERGE CHUNKS
+*****************************************************************************************/
+
+/* Seconds on the Monotonic Clock */
+static double _now( void ) {
+
+  struct timespec ts;
+
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/***
+    Find the Lines of txt
+
+    addRow is called once per line, in order, with the line's offset
+    and length, including the '\n'.  Returns the number of lines found.
+***/
+size_t scanLines( const char *txt, size_t len, void (*addRow)( size_t, size_t )) {
+
+  int i, nChunks;
+  size_t j, start, lines, chunkLen;
+
+  chunk_t   chunk[MAXTHRDS];
+  pthread_t thread[MAXTHRDS];
+  bool      joinP[MAXTHRDS];
+
+  double t0 = _now();
+
+  /* One Chunk per CPU, Unless the Text is Small */
+  long cpus = sysconf( _SC_NPROCESSORS_ONLN );
+  nChunks = ( cpus < 1 ) ? 1 : ( cpus > MAXTHRDS ) ? MAXTHRDS : (int)cpus;
+
+  if( len / MINCHUNK < (size_t)nChunks )
+    nChunks = ( len / MINCHUNK ) > 0 ? (int)( len / MINCHUNK ) : 1;
+
+  chunkLen = ( len + nChunks - 1 ) / nChunks;
+  while( chunkLen > MAXCHUNK ) {
+    nChunks++;
+    chunkLen = ( len + nChunks - 1 ) / nChunks;
+  }
+
+  if( nChunks > MAXTHRDS )
+    die( "scanLines: text too large" );
+
+  /* Split Text Into Chunks */
+  for( i = 0; i<nChunks; i++ ) {
+    memset( &chunk[i], 0, sizeof( chunk_t ));
+    chunk[i].txt = txt + i * chunkLen;
+    chunk[i].len = ( i == nChunks - 1 ) ? len - i * chunkLen : chunkLen;
+  }
+
+  /* Scan Chunks in Parallel, This Thread Takes the First */
+  for( i = 1; i<nChunks; i++ ) {
+    joinP[i] = ( pthread_create( &thread[i], NULL, _scanChunk, &chunk[i] ) == 0 );
+    if( !joinP[i] )
+      _scanChunk( &chunk[i] );
+  }
+
+  _scanChunk( &chunk[0] );
+
+  for( i = 1; i<nChunks; i++ )
+    if( joinP[i] ) pthread_join( thread[i], NULL );
+
+  /* Merge Chunk Tables Into Rows */
+  start = 0;
+  lines = 0;
+
+  for( i = 0; i<nChunks; i++ ) {
+
+    size_t base = chunk[i].txt - txt;
+
+    for( j = 0; j<chunk[i].n; j++ ) {
+
+      size_t end = base + chunk[i].ends[j];
+
+      addRow( start, end - start );
+      start = end;
+      lines++;
+    }
+
+    free( chunk[i].ends );
+  }
+
+  /* Last Line Without a Newline */
+  if( start < len ) {
+    addRow( start, len - start );
+    lines++;
+  }
+
+  SCANSECS  = _now() - t0;
+  SCANTHRDS = nChunks;
+
+  return lines;
+}
+
+/* Seconds Spent in Last Scan */
+double getLineScanSeconds( void ) {
+
+  return SCANSECS;
+}
+
+/* Threads Used in Last Scan */
+int getLineScanThreads( void ) {
+
+  return SCANTHRDS;
+}
+
+
+/***
+    Local Variables:
+    mode: c
+    tags-file-name: "~/ae/TAGS"
+    comment-column: 45
+    fill-column: 90
+    End:
+ ***/
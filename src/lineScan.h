@@ -0,0 +1,4 @@
+/* Newline Indexer */
+size_t scanLines( const char *, size_t, void (*)( size_t, size_t ));
+double getLineScanSeconds( void );
+int getLineScanThreads( void );
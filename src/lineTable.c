@@ -0,0 +1,1265 @@
+/***
+==========================================================================================
+                      _              _         _____    _ _ _
+                     / \   _ __   __| |_   _  | ____|__| (_) |_
+                    / _ \ | '_ \ / _` | | | | |  _| / _` | | __|
+                   / ___ \| | | | (_| | |_| | | |__| (_| | | |_
+                  /_/   \_\_| |_|\__,_|\__, | |_____\__,_|_|\__|  v0.5-beta
+                                       |___/
+
+        Copyright 2020 (andrew.suttles@gmail.com)
+        MIT LICENSE
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+ INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE 
+ LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT 
+ OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ DEALINGS IN THE SOFTWARE.
+
+ AndyEDIT is a simple, line-oriented, terminal-based text editor with emacs-like keybindings.
+
+ For more information about AndyEdit, see README.md.
+
+==========================================================================================
+ ***/
+#define _POSIX_C_SOURCE 200809L		     /* clock_gettime() is POSIX */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ae.h"
+#include "buffer.h"
+#include "arena.h"
+#include "lineTable.h"
+
+/***
+    Counted B-Tree of Line Chunks
+
+    Rows live in leaves of up to LEAFMAX rows.  Interior nodes keep the
+    number of rows and of text bytes below each child, so finding,
+    inserting or deleting row i, or finding the row holding byte n, only
+    walks one root-to-leaf path.  The last leaf found is kept
+    as a finger, so repeated work near the cursor skips the walk, and
+    nodes left under a quarter full are joined with a neighbour.
+
+    Leaves store rows as parallel arrays: a 64 bit text offset, a 32 bit
+    length and one bit marking rows whose text was edited into the ADD
+    buffer, about 12 bytes per line.  Callers get and put rows by value.
+    The top length bit flags short lines kept inline in the offset, or
+    with the ADD bit also set, a chunked line whose offset is the chunk
+    list.
+
+    A snapshot shares the whole tree by counting a reference to the
+    root.  Changes then copy each shared node on their path before
+    touching it, so a snapshot reads the rows as they were while the
+    live table moves on.  Only the editor thread counts references.
+
+    Leaves far from the screen are packed while the editor is idle:
+    each row becomes two bits of kind, a varint length, and a varint
+    offset unless the row follows the text of the row before, as file
+    rows do.  A packed leaf is the node header and its code, so a leaf
+    of short file lines shrinks about tenfold.  Finding a row in a
+    packed leaf unpacks it, owning its path as a change would.
+***/
+
+/* Module Constants */
+#define LEAFMAX  128			     /* Max Rows in a Leaf */
+#define NODEMAX  64			     /* Max Children of a Node */
+#define MAXDEPTH 16			     /* Max Height of Tree */
+#define BITWORDS ( LEAFMAX / 64 )	     /* Edited Bitset Words */
+#define INLINEBIT 0x80000000u		     /* Length Flag, Text in Offset */
+#define PACKMIN  1024			     /* Unpacked Leaves Worth Packing */
+#define PACKROW  16			     /* Most Code Bytes per Row */
+
+/* Packed Row Kinds */
+enum _pk { PKNEXT, PKORIG, PKADD, PKINLINE };
+
+/* Node Header, First in Every Kind of Node */
+typedef struct {
+  bool leafP;				     /* Leaf or Interior Node */
+  bool packedP;				     /* Leaf Rows Coded After Header */
+  int  n;				     /* Number of Rows or Children */
+  int  ref;				     /* Trees Sharing This Node */
+  int  pack;				     /* Index in PACKS, if Packed */
+} head_t;
+
+/* Tree Node */
+typedef struct _node {
+  head_t h;
+  union {
+    struct {
+      int count[NODEMAX];		     /* Rows Below Each Child */
+      uint64_t bytes[NODEMAX];		     /* Text Bytes Below Each Child */
+      struct _node *kid[NODEMAX];	     /* Children */
+    } in;
+    struct {
+      uint64_t off[LEAFMAX];		     /* Text Offsets */
+      uint32_t len[LEAFMAX];		     /* Text Lengths */
+      uint64_t add[BITWORDS];		     /* Rows With ADD Buffer Text */
+    } lf;
+  } u;
+} node_t;
+
+/***
+    Packed Leaf
+
+    Only the header and the code are allocated, so a packed leaf is not
+    a node_t.  It sits in the tree as one, and is read only through its
+    header until packedP is checked.
+***/
+typedef struct {
+  head_t h;
+  unsigned char code[];			     /* Rows, Coded */
+} packed_t;
+
+/* Step on Root-to-Leaf Path */
+typedef struct {
+  node_t *node;
+  int     slot;				     /* Child Taken */
+} step_t;
+
+/* Module Private Data */
+static slab_t LEAVES = { sizeof( node_t ), NULL, NULL, 0, 0, 0 };
+static slab_t NODES  = { offsetof( node_t, u ) + sizeof((( node_t *)0)->u.in ),
+			 NULL, NULL, 0, 0, 0 };
+static node_t *ROOT = NULL;		     /* Root of Line Tree */
+static int NUMROWS  = 0;		     /* Rows in Tree */
+static uint64_t NUMBYTES = 0;		     /* Text Bytes in Tree */
+static int SNAPS    = 0;		     /* Snapshots Not Yet Released */
+
+static struct {				     /* Packed Leaves, Freed in Bulk */
+  packed_t **leaf;			     /* NULL Once Freed */
+  int      n;
+  int      max;
+  int      live;
+  size_t   bytes;			     /* Code Bytes */
+  unsigned long decodes;		     /* Leaves Unpacked */
+  double   decodeSecs;
+} PACKS;
+
+static struct {				     /* Last Leaf Found */
+  node_t *leaf;				     /* NULL After Tree Changes Shape */
+  int     first;			     /* Index of Its First Row */
+  int     depth;
+  step_t  path[MAXDEPTH];
+} FINGER;
+
+
+/*****************************************************************************************
+				      NODE MANAGEMENT
+*****************************************************************************************/
+
+/* Allocate an Empty Node */
+static node_t *_newNode( bool leafP ) {
+
+  node_t *nd = slabAlloc( leafP ? &LEAVES : &NODES );
+
+  nd->h.leafP   = leafP;
+  nd->h.packedP = false;
+  nd->h.n       = 0;
+  nd->h.ref     = 1;
+
+  return nd;
+}
+
+/* Header of a Node That May Be a Packed Leaf */
+static head_t *_head( const node_t *nd ) {
+
+  return (head_t *)nd;
+}
+
+/* A Node Whose Header Says It is Packed */
+static packed_t *_packed( const node_t *nd ) {
+
+  return (packed_t *)nd;
+}
+
+static size_t _packedBytes( const packed_t * );
+
+/* Return a Node to Its Slab, Packed Leaves to the Heap */
+static void _freeNode( node_t *nd ) {
+
+  packed_t *pk;
+
+  if( _head( nd )->packedP ) {
+    pk = _packed( nd );
+    PACKS.leaf[ pk->h.pack ] = NULL;
+    PACKS.live--;
+    PACKS.bytes -= _packedBytes( pk );
+    free( pk );
+    return;
+  }
+
+  slabFree( nd->h.leafP ? &LEAVES : &NODES, nd );
+}
+
+/* Drop a Reference, Freeing Nodes No Tree Shares */
+static void _unrefNode( node_t *nd ) {
+
+  if( --_head( nd )->ref > 0 )
+    return;
+
+  if( !_head( nd )->leafP )
+    for( int k = 0; k<nd->h.n; k++ )
+      _unrefNode( nd->u.in.kid[k] );
+
+  _freeNode( nd );
+}
+
+/* Private Copy of a Shared Node, Its Children Gain a Reference */
+static node_t *_copyNode( node_t *nd ) {
+
+  node_t *cp = slabAlloc( nd->h.leafP ? &LEAVES : &NODES );
+
+  memcpy( cp, nd, nd->h.leafP ? LEAVES.size : NODES.size );
+  cp->h.ref = 1;
+
+  if( !cp->h.leafP )
+    for( int k = 0; k<cp->h.n; k++ )
+      cp->u.in.kid[k]->h.ref++;
+
+  nd->h.ref--;
+  FINGER.leaf = NULL;			     /* Finger May Hold the Shared Node */
+
+  return cp;
+}
+
+static node_t *_unpackLeaf( node_t * );
+
+/* Make Child slot of an Unshared Node Unshared, and Unpacked */
+static node_t *_ownKid( node_t *nd, int slot ) {
+
+  if( _head( nd->u.in.kid[slot] )->packedP )
+    nd->u.in.kid[slot] = _unpackLeaf( nd->u.in.kid[slot] );
+  else if( nd->u.in.kid[slot]->h.ref > 1 )
+    nd->u.in.kid[slot] = _copyNode( nd->u.in.kid[slot] );
+
+  return nd->u.in.kid[slot];
+}
+
+static node_t *_ownRoot( void ) {
+
+  if( _head( ROOT )->packedP )
+    ROOT = _unpackLeaf( ROOT );
+  else if( ROOT->h.ref > 1 )
+    ROOT = _copyNode( ROOT );
+
+  return ROOT;
+}
+
+/* Unshare Every Node on path, Return the Leaf */
+static node_t *_ownPath( step_t *path, int depth ) {
+
+  node_t *nd = _ownRoot();
+
+  for( int d = 0; d<depth; d++ ) {
+    path[d].node = nd;
+    nd = _ownKid( nd, path[d].slot );
+  }
+
+  return nd;
+}
+
+/*****************************************************************************************
+				       LEAF ROWS
+*****************************************************************************************/
+
+/* Edited Bit of Leaf Row i */
+static bool _addBitP( const node_t *lf, int i ) {
+
+  return ( lf->u.lf.add[ i / 64 ] >> ( i % 64 )) & 1;
+}
+
+static void _setAddBit( node_t *lf, int i, bool bit ) {
+
+  uint64_t mask = (uint64_t)1 << ( i % 64 );
+
+  if( bit )
+    lf->u.lf.add[ i / 64 ] |= mask;
+  else
+    lf->u.lf.add[ i / 64 ] &= ~mask;
+}
+
+/* Decode Leaf Row i */
+static row_t _getRow( const node_t *lf, int i ) {
+
+  row_t r;
+
+  r.off = lf->u.lf.off[i];
+  r.len = lf->u.lf.len[i] & ~INLINEBIT;
+
+  if( lf->u.lf.len[i] & INLINEBIT )
+    r.src = _addBitP( lf, i ) ? CHUNKTEXT : INLINETEXT;
+  else
+    r.src = _addBitP( lf, i ) ? ADDTEXT : ORIGTEXT;
+
+  return r;
+}
+
+/* Encode Leaf Row i */
+static void _putRow( node_t *lf, int i, row_t r ) {
+
+  if( r.len >= INLINEBIT )
+    die( "_putRow: line too long" );
+
+  lf->u.lf.off[i] = r.off;
+  lf->u.lf.len[i] = r.len | ( r.src == INLINETEXT || r.src == CHUNKTEXT ? INLINEBIT : 0 );
+  _setAddBit( lf, i, r.src == ADDTEXT || r.src == CHUNKTEXT );
+}
+
+/* Move n Rows From src[si] to dst[di], Ranges May Overlap */
+static void _moveRows( node_t *dst, int di, node_t *src, int si, int n ) {
+
+  int i;
+
+  memmove( dst->u.lf.off + di, src->u.lf.off + si, n * sizeof( uint64_t ));
+  memmove( dst->u.lf.len + di, src->u.lf.len + si, n * sizeof( uint32_t ));
+
+  if( dst == src && di > si ) {
+    for( i = n-1; i>=0; i-- )
+      _setAddBit( dst, di+i, _addBitP( src, si+i ));
+  }
+  else {
+    for( i = 0; i<n; i++ )
+      _setAddBit( dst, di+i, _addBitP( src, si+i ));
+  }
+}
+
+/* Text Bytes in Leaf Rows from .. to-1 */
+static uint64_t _leafBytes( const node_t *lf, int from, int to ) {
+
+  uint64_t bytes = 0;
+
+  for( int i = from; i<to; i++ )
+    bytes += lf->u.lf.len[i] & ~INLINEBIT;
+
+  return bytes;
+}
+
+
+/*****************************************************************************************
+				      PACKED LEAVES
+*****************************************************************************************/
+
+/* Seconds on the Monotonic Clock */
+static double _now( void ) {
+
+  struct timespec ts;
+
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned char *_putVarint( unsigned char *p, uint64_t v ) {
+
+  while( v >= 0x80 ) {
+    *p++ = (unsigned char)( v | 0x80 );
+    v >>= 7;
+  }
+  *p++ = (unsigned char)v;
+
+  return p;
+}
+
+static const unsigned char *_getVarint( const unsigned char *p, uint64_t *v ) {
+
+  int shift = 0;
+
+  *v = 0;
+  do {
+    *v |= (uint64_t)( *p & 0x7f ) << shift;
+    shift += 7;
+  } while( *p++ & 0x80 );
+
+  return p;
+}
+
+/* Kind of Packed Row i, Two Bits Each at the Start of the Code */
+static enum _pk _kind( const unsigned char *code, int i ) {
+
+  return ( code[ i / 4 ] >> ( 2 * ( i % 4 ))) & 3;
+}
+
+/* Code the Rows of a Leaf, Return Its Length */
+static size_t _encodeRows( const node_t *lf, unsigned char *code ) {
+
+  unsigned char *p = code + ( lf->h.n + 3 ) / 4;
+  uint64_t end = 0;				     /* End of Prior Row Text */
+
+  memset( code, 0, ( lf->h.n + 3 ) / 4 );
+
+  for( int i = 0; i<lf->h.n; i++ ) {
+
+    row_t r = _getRow( lf, i );
+    enum _pk kind = ( r.src == INLINETEXT ||
+		      r.src == CHUNKTEXT )  ? PKINLINE :
+                    ( r.src == ADDTEXT )    ? PKADD    :
+                    ( r.off == end )        ? PKNEXT   : PKORIG;
+
+    code[ i / 4 ] |= kind << ( 2 * ( i % 4 ));
+
+    /* Inline Lengths Carry a Chunked Line Flag */
+    if( kind == PKINLINE ) {
+      p = _putVarint( p, ( r.len << 1 ) | ( r.src == CHUNKTEXT ));
+      memcpy( p, &r.off, sizeof( r.off ));
+      p += sizeof( r.off );
+      continue;
+    }
+
+    p = _putVarint( p, r.len );
+
+    /* Offset From the End of the Prior Row, Zigzag Signed */
+    if( kind != PKNEXT ) {
+      int64_t d = (int64_t)( r.off - end );
+      p = _putVarint( p, ( (uint64_t)d << 1 ) ^ (uint64_t)( d >> 63 ));
+    }
+
+    end = r.off + r.len;
+  }
+
+  return (size_t)( p - code );
+}
+
+/* Decode a Packed Leaf Into the Full Leaf lf */
+static void _decodeRows( const packed_t *pk, node_t *lf ) {
+
+  const unsigned char *code = pk->code;
+  const unsigned char *p    = code + ( pk->h.n + 3 ) / 4;
+  uint64_t v, d, end = 0;
+  row_t r;
+
+  lf->h.leafP   = true;
+  lf->h.packedP = false;
+  lf->h.n       = pk->h.n;
+  lf->h.ref     = 1;
+
+  for( int i = 0; i<pk->h.n; i++ ) {
+
+    p = _getVarint( p, &v );
+    r.len = v;
+
+    switch( _kind( code, i )) {
+    case PKINLINE:
+      memcpy( &r.off, p, sizeof( r.off ));
+      p += sizeof( r.off );
+      r.len = v >> 1;
+      r.src = ( v & 1 ) ? CHUNKTEXT : INLINETEXT;
+      _putRow( lf, i, r );
+      continue;
+
+    case PKNEXT:
+      r.off = end;
+      r.src = ORIGTEXT;
+      break;
+
+    default:
+      p = _getVarint( p, &d );
+      r.off = end + (( d >> 1 ) ^ ( 0 - ( d & 1 )));
+      r.src = ( _kind( code, i ) == PKADD ) ? ADDTEXT : ORIGTEXT;
+    }
+
+    _putRow( lf, i, r );
+    end = r.off + r.len;
+  }
+}
+
+/* Length of a Packed Leaf's Code */
+static size_t _packedBytes( const packed_t *pk ) {
+
+  const unsigned char *code = pk->code;
+  const unsigned char *p    = code + ( pk->h.n + 3 ) / 4;
+  uint64_t v;
+
+  for( int i = 0; i<pk->h.n; i++ ) {
+    p = _getVarint( p, &v );
+    if( _kind( code, i ) == PKINLINE )
+      p += sizeof( uint64_t );
+    else if( _kind( code, i ) != PKNEXT )
+      p = _getVarint( p, &v );
+  }
+
+  return (size_t)( p - code );
+}
+
+/* Packed Copy of a Leaf, NULL If It Would Not Shrink by Half */
+static node_t *_packLeaf( node_t *lf ) {
+
+  unsigned char code[ LEAFMAX * PACKROW + LEAFMAX / 4 ];
+  size_t size = _encodeRows( lf, code );
+  packed_t *pk;
+
+  if( size > sizeof( lf->u.lf ) / 2 )
+    return NULL;
+
+  if(( pk = malloc( sizeof( packed_t ) + size )) == NULL )
+    die( "_packLeaf: malloc failed" );
+
+  pk->h.leafP   = true;
+  pk->h.packedP = true;
+  pk->h.n       = lf->h.n;
+  pk->h.ref     = 1;
+  memcpy( pk->code, code, size );
+
+  /* Remember It, So Freeing the Table Finds It */
+  if( PACKS.n == PACKS.max ) {
+    PACKS.max = PACKS.max ? PACKS.max * 2 : 1024;
+    if(( PACKS.leaf = realloc( PACKS.leaf, PACKS.max * sizeof( packed_t * ))) == NULL )
+      die( "_packLeaf: realloc failed" );
+  }
+  pk->h.pack = PACKS.n;
+  PACKS.leaf[ PACKS.n++ ] = pk;
+  PACKS.live++;
+  PACKS.bytes += size;
+
+  return (node_t *)pk;
+}
+
+/* Private Full Leaf in Place of a Packed One */
+static node_t *_unpackLeaf( node_t *pk ) {
+
+  double t0  = _now();
+  node_t *lf = _newNode( true );
+
+  _decodeRows( _packed( pk ), lf );
+  _unrefNode( pk );
+  FINGER.leaf = NULL;
+
+  PACKS.decodes++;
+  PACKS.decodeSecs += _now() - t0;
+
+  return lf;
+}
+
+/* Close the Gaps Freed Leaves Leave in PACKS */
+static void _compactPacks( void ) {
+
+  int i, j;
+
+  if( PACKS.n < 2 * PACKS.live + 1024 ) return;
+
+  for( i = j = 0; i<PACKS.n; i++ )
+    if( PACKS.leaf[i] ) {
+      PACKS.leaf[i]->h.pack = j;
+      PACKS.leaf[j++] = PACKS.leaf[i];
+    }
+
+  PACKS.n = j;
+}
+
+/* Pack Unshared Leaves Below nd, Whose First Row is row, Outside first .. last */
+static void _packNode( node_t *nd, int row, int first, int last ) {
+
+  node_t *kid, *pk;
+
+  for( int k = 0; k<nd->h.n; k++ ) {
+
+    kid = nd->u.in.kid[k];
+
+    if( _head( kid )->ref == 1 && !_head( kid )->packedP ) {
+      if( !kid->h.leafP )
+	_packNode( kid, row, first, last );
+      else if(( row + nd->u.in.count[k] <= first || row > last ) &&
+	      ( pk = _packLeaf( kid )) != NULL ) {
+	_freeNode( kid );
+	nd->u.in.kid[k] = pk;
+      }
+    }
+
+    row += nd->u.in.count[k];
+  }
+}
+
+/* Copy Unpacked Nodes Into Fresh Slabs */
+static node_t *_moveNode( node_t *nd, slab_t *leaves, slab_t *nodes ) {
+
+  node_t *cp;
+
+  if( _head( nd )->packedP ) return nd;
+
+  cp = slabAlloc( nd->h.leafP ? leaves : nodes );
+  memcpy( cp, nd, nd->h.leafP ? leaves->size : nodes->size );
+
+  if( !cp->h.leafP )
+    for( int k = 0; k<cp->h.n; k++ )
+      cp->u.in.kid[k] = _moveNode( cp->u.in.kid[k], leaves, nodes );
+
+  return cp;
+}
+
+/* Slabs Only Give Back Whole Blocks, So Move the Tree to Drop Them */
+static void _moveTree( void ) {
+
+  slab_t leaves = { LEAVES.size, NULL, NULL, 0, 0, 0 };
+  slab_t nodes  = { NODES.size, NULL, NULL, 0, 0, 0 };
+
+  ROOT = _moveNode( ROOT, &leaves, &nodes );
+
+  slabRelease( &LEAVES );
+  slabRelease( &NODES );
+  LEAVES = leaves;
+  NODES  = nodes;
+
+  FINGER.leaf = NULL;
+}
+
+/* Find Leaf Holding Row *idx, Recording Path; *idx Becomes Index in Leaf */
+static node_t *_findLeaf( int *idx, step_t *path, int *depth ) {
+
+  int k;
+  int d = 0;
+  int row = *idx;
+  node_t *nd = ROOT;
+
+  /* Row in Finger Leaf, or Appended to the Last Leaf */
+  if( FINGER.leaf &&
+      row >= FINGER.first &&
+      ( row < FINGER.first + FINGER.leaf->h.n ||
+	( row == NUMROWS && row == FINGER.first + FINGER.leaf->h.n ))) {
+
+    memcpy( path, FINGER.path, FINGER.depth * sizeof( step_t ));
+    *depth = FINGER.depth;
+    *idx  -= FINGER.first;
+    return FINGER.leaf;
+  }
+
+  while( !_head( nd )->leafP ) {
+
+    /* Skip Children Before Row */
+    for( k = 0; k < nd->h.n - 1 && *idx >= nd->u.in.count[k]; k++ )
+      *idx -= nd->u.in.count[k];
+
+    path[d].node = nd;
+    path[d].slot = k;
+    d++;
+
+    nd = nd->u.in.kid[k];
+  }
+
+  /* Unpack on First Touch */
+  if( _head( nd )->packedP )
+    nd = _ownPath( path, d );
+
+  *depth = d;
+
+  /* Remember This Leaf */
+  FINGER.leaf  = nd;
+  FINGER.first = row - *idx;
+  FINGER.depth = d;
+  memcpy( FINGER.path, path, d * sizeof( step_t ));
+
+  return nd;
+}
+
+
+/*****************************************************************************************
+				   SPLIT AND JOIN NODES
+*****************************************************************************************/
+
+/* Insert kid After the path[d] Slot, Splitting Full Nodes Up the Tree */
+static void _addChild( step_t *path, int d, node_t *kid, int kidRows, uint64_t kidBytes ) {
+
+  node_t *nd, *sib;
+  int slot, half, sibRows;
+  uint64_t sibBytes;
+
+  FINGER.leaf = NULL;
+
+  /* Root Split, Grow Tree */
+  if( d < 0 ) {
+    nd = _newNode( false );
+    nd->h.n = 2;
+    nd->u.in.kid[0]   = ROOT;
+    nd->u.in.count[0] = NUMROWS - kidRows;
+    nd->u.in.bytes[0] = NUMBYTES - kidBytes;
+    nd->u.in.kid[1]   = kid;
+    nd->u.in.count[1] = kidRows;
+    nd->u.in.bytes[1] = kidBytes;
+    ROOT = nd;
+    return;
+  }
+
+  nd   = path[d].node;
+  slot = path[d].slot + 1;
+  nd->u.in.count[slot-1] -= kidRows;	     /* Rows Moved Into kid */
+  nd->u.in.bytes[slot-1] -= kidBytes;
+
+  /* Split Full Node, Appends Leave the Old Node Full */
+  sib = NULL;
+  sibRows  = 0;
+  sibBytes = 0;
+  if( nd->h.n == NODEMAX ) {
+
+    half = ( slot == NODEMAX ) ? NODEMAX : NODEMAX / 2;
+    sib  = _newNode( false );
+    sib->h.n = nd->h.n - half;
+
+    memcpy( sib->u.in.kid, nd->u.in.kid + half, sib->h.n * sizeof( node_t * ));
+    memcpy( sib->u.in.count, nd->u.in.count + half, sib->h.n * sizeof( int ));
+    memcpy( sib->u.in.bytes, nd->u.in.bytes + half, sib->h.n * sizeof( uint64_t ));
+    for( int i = 0; i<sib->h.n; i++ ) {
+      sibRows  += sib->u.in.count[i];
+      sibBytes += sib->u.in.bytes[i];
+    }
+    nd->h.n = half;
+
+    if( slot >= half ) {
+      nd = sib;
+      slot -= half;
+      sibRows  += kidRows;
+      sibBytes += kidBytes;
+    }
+  }
+
+  /* Insert kid at slot */
+  memmove( nd->u.in.kid + slot + 1, nd->u.in.kid + slot,
+	   ( nd->h.n - slot ) * sizeof( node_t * ));
+  memmove( nd->u.in.count + slot + 1, nd->u.in.count + slot,
+	   ( nd->h.n - slot ) * sizeof( int ));
+  memmove( nd->u.in.bytes + slot + 1, nd->u.in.bytes + slot,
+	   ( nd->h.n - slot ) * sizeof( uint64_t ));
+  nd->u.in.kid[slot]   = kid;
+  nd->u.in.count[slot] = kidRows;
+  nd->u.in.bytes[slot] = kidBytes;
+  nd->h.n++;
+
+  if( sib )
+    _addChild( path, d-1, sib, sibRows, sibBytes );
+}
+
+static void _joinSibling( step_t *, int );
+
+/* Remove Empty kid From the path[d] Slot, Freeing Empty Nodes Up the Tree */
+static void _removeChild( step_t *path, int d, node_t *kid ) {
+
+  node_t *nd;
+  int slot;
+
+  FINGER.leaf = NULL;
+
+  /* Keep an Empty Root Leaf */
+  if( d < 0 ) {
+    if( !_head( kid )->leafP ) {
+      _freeNode( kid );
+      ROOT = _newNode( true );
+    }
+    return;
+  }
+
+  nd   = path[d].node;
+  slot = path[d].slot;
+
+  _freeNode( kid );
+  memmove( nd->u.in.kid + slot, nd->u.in.kid + slot + 1,
+	   ( nd->h.n - slot - 1 ) * sizeof( node_t * ));
+  memmove( nd->u.in.count + slot, nd->u.in.count + slot + 1,
+	   ( nd->h.n - slot - 1 ) * sizeof( int ));
+  memmove( nd->u.in.bytes + slot, nd->u.in.bytes + slot + 1,
+	   ( nd->h.n - slot - 1 ) * sizeof( uint64_t ));
+  nd->h.n--;
+
+  if( nd->h.n == 0 )
+    _removeChild( path, d-1, nd );
+  else if( nd->h.n < NODEMAX / 4 )
+    _joinSibling( path, d-1 );
+}
+
+/* Join the Child at path[d] With a Neighbour, If Both Fit in One Node */
+static void _joinSibling( step_t *path, int d ) {
+
+  node_t *nd, *lt, *rt;
+  int slot;
+
+  if( d < 0 ) return;
+
+  nd   = path[d].node;
+  slot = path[d].slot;
+
+  if( nd->h.n < 2 ) return;
+  if( slot == nd->h.n - 1 ) slot--;	     /* Last Child Joins Its Left */
+
+  lt = nd->u.in.kid[slot];
+  rt = nd->u.in.kid[slot+1];
+
+  if( lt->h.n + rt->h.n > ( lt->h.leafP ? LEAFMAX : NODEMAX )) return;
+
+  /* Both Change, So Neither May Be Shared */
+  lt = _ownKid( nd, slot );
+  rt = _ownKid( nd, slot+1 );
+
+  if( lt->h.n + rt->h.n > ( lt->h.leafP ? LEAFMAX : NODEMAX )) return;
+
+  /* Move Right Node Into Left */
+  if( lt->h.leafP ) {
+    _moveRows( lt, lt->h.n, rt, 0, rt->h.n );
+  }
+  else {
+    memcpy( lt->u.in.kid + lt->h.n, rt->u.in.kid, rt->h.n * sizeof( node_t * ));
+    memcpy( lt->u.in.count + lt->h.n, rt->u.in.count, rt->h.n * sizeof( int ));
+    memcpy( lt->u.in.bytes + lt->h.n, rt->u.in.bytes, rt->h.n * sizeof( uint64_t ));
+  }
+  lt->h.n += rt->h.n;
+  rt->h.n  = 0;
+
+  nd->u.in.count[slot]  += nd->u.in.count[slot+1];
+  nd->u.in.count[slot+1] = 0;
+  nd->u.in.bytes[slot]  += nd->u.in.bytes[slot+1];
+  nd->u.in.bytes[slot+1] = 0;
+
+  /* Drop the Empty Right Node */
+  path[d].slot = slot + 1;
+  _removeChild( path, d, rt );
+}
+
+/* Drop Interior Roots With a Single Child */
+static void _collapseRoot( void ) {
+
+  node_t *nd;
+
+  while( !_head( ROOT )->leafP && ROOT->h.n == 1 ) {
+    FINGER.leaf = NULL;
+    nd   = _ownRoot();
+    ROOT = nd->u.in.kid[0];
+    _freeNode( nd );
+  }
+}
+
+
+/*****************************************************************************************
+				    LINE TABLE INTERFACE
+*****************************************************************************************/
+
+/* Create an Empty Line Table */
+void initializeLineTable( void ) {
+
+  ROOT     = _newNode( true );
+  NUMROWS  = 0;
+  NUMBYTES = 0;
+
+  FINGER.leaf = NULL;
+}
+
+/* Release Every Node a Slab Block at a Time, Snapshots Too */
+void freeLineTable( void ) {
+
+  slabRelease( &LEAVES );
+  slabRelease( &NODES );
+
+  for( int i = 0; i<PACKS.n; i++ )
+    free( PACKS.leaf[i] );
+  free( PACKS.leaf );
+  memset( &PACKS, 0, sizeof( PACKS ));
+  SNAPS = 0;
+
+  FINGER.leaf = NULL;
+
+  ROOT     = NULL;
+  NUMROWS  = 0;
+  NUMBYTES = 0;
+}
+
+/* Number of Rows in Table */
+int getLineTableRows( void ) {
+
+  return NUMROWS;
+}
+
+/* Get Row idx */
+row_t getLineTableRow( int idx ) {
+
+  int depth;
+  step_t path[MAXDEPTH];
+
+  node_t *leaf = _findLeaf( &idx, path, &depth );
+
+  return _getRow( leaf, idx );
+}
+
+/* Replace Row idx */
+void setLineTableRow( int idx, row_t r ) {
+
+  int d, depth;
+  step_t path[MAXDEPTH];
+  uint64_t was;
+
+  node_t *leaf = _findLeaf( &idx, path, &depth );
+
+  leaf = _ownPath( path, depth );
+  was  = leaf->u.lf.len[idx] & ~INLINEBIT;
+
+  /* Account for Changed Length Along Path */
+  for( d = 0; d<depth; d++ )
+    path[d].node->u.in.bytes[ path[d].slot ] += r.len - was;
+  NUMBYTES += r.len - was;
+
+  _putRow( leaf, idx, r );
+}
+
+/* Insert Row r Before Row idx */
+void insertLineTableRow( int idx, row_t r ) {
+
+  int d, depth, half;
+  step_t path[MAXDEPTH];
+  node_t *sib = NULL;
+
+  node_t *leaf = _findLeaf( &idx, path, &depth );
+
+  leaf = _ownPath( path, depth );
+
+  /* Account for New Row Along Path */
+  for( d = 0; d<depth; d++ ) {
+    path[d].node->u.in.count[ path[d].slot ]++;
+    path[d].node->u.in.bytes[ path[d].slot ] += r.len;
+  }
+  NUMROWS++;
+  NUMBYTES += r.len;
+
+  /* Split Full Leaf, Appends Leave the Old Leaf Full */
+  if( leaf->h.n == LEAFMAX ) {
+
+    half = ( idx == LEAFMAX ) ? LEAFMAX : LEAFMAX / 2;
+    sib  = _newNode( true );
+    sib->h.n = leaf->h.n - half;
+    _moveRows( sib, 0, leaf, half, sib->h.n );
+    leaf->h.n = half;
+
+    if( idx >= half ) {
+      leaf = sib;
+      idx -= half;
+    }
+  }
+
+  /* Open Slot in Leaf */
+  _moveRows( leaf, idx + 1, leaf, idx, leaf->h.n - idx );
+  _putRow( leaf, idx, r );
+  leaf->h.n++;
+
+  if( sib )
+    _addChild( path, depth-1, sib, sib->h.n, _leafBytes( sib, 0, sib->h.n ));
+}
+
+/***
+    Insert n Rows Before Row idx, a Leaf at a Time
+
+    Each pass fills the leaf at idx with as many rows as it has room
+    for.  A full leaf is first split at idx, the rows after it moving
+    to a new leaf, so a block of rows costs a walk and a split per leaf
+    filled rather than per row.
+***/
+void insertLineTableRows( int idx, const row_t *rows, int n ) {
+
+  int d, depth, off, k, i;
+  step_t path[MAXDEPTH];
+  node_t *leaf, *sib, *to;
+  uint64_t bytes;
+
+  while( n > 0 ) {
+
+    off  = idx;
+    leaf = _findLeaf( &off, path, &depth );
+    leaf = _ownPath( path, depth );
+    sib  = NULL;
+    to   = leaf;
+
+    /* Full Leaf, Rows From idx On Move to a New Leaf */
+    if( leaf->h.n == LEAFMAX ) {
+      sib    = _newNode( true );
+      sib->h.n = leaf->h.n - off;
+      _moveRows( sib, 0, leaf, off, sib->h.n );
+      leaf->h.n = off;
+
+      if( off == LEAFMAX ) {		     /* Appending, Fill the New Leaf */
+	to  = sib;
+	off = 0;
+      }
+    }
+
+    k = LEAFMAX - to->h.n;
+    if( k > n ) k = n;
+
+    for( bytes = 0, i = 0; i<k; i++ )
+      bytes += rows[i].len;
+
+    /* Account for New Rows Along Path */
+    for( d = 0; d<depth; d++ ) {
+      path[d].node->u.in.count[ path[d].slot ] += k;
+      path[d].node->u.in.bytes[ path[d].slot ] += bytes;
+    }
+    NUMROWS  += k;
+    NUMBYTES += bytes;
+
+    _moveRows( to, off + k, to, off, to->h.n - off );
+    for( i = 0; i<k; i++ )
+      _putRow( to, off + i, rows[i] );
+    to->h.n += k;
+
+    if( sib )
+      _addChild( path, depth-1, sib, sib->h.n, _leafBytes( sib, 0, sib->h.n ));
+
+    idx  += k;
+    rows += k;
+    n    -= k;
+  }
+}
+
+/* Add Row r After the Last Row, Fast Path for Loading Files */
+void appendLineTableRow( row_t r ) {
+
+  node_t *nd = _ownRoot();
+
+  /* Walk Down the Right Edge */
+  while( !nd->h.leafP )
+    nd = _ownKid( nd, nd->h.n - 1 );
+
+  if( nd->h.n == LEAFMAX ) {
+    insertLineTableRow( NUMROWS, r );
+    return;
+  }
+
+  /* Room in Last Leaf, Just Bump the Counts */
+  for( node_t *in = ROOT; !in->h.leafP; in = in->u.in.kid[ in->h.n - 1 ] ) {
+    in->u.in.count[ in->h.n - 1 ]++;
+    in->u.in.bytes[ in->h.n - 1 ] += r.len;
+  }
+  NUMROWS++;
+  NUMBYTES += r.len;
+
+  _putRow( nd, nd->h.n++, r );
+}
+
+/* Delete count Rows Starting at Row idx */
+void deleteLineTableRows( int idx, int count ) {
+
+  int d, depth, k, off;
+  step_t path[MAXDEPTH];
+  node_t *leaf;
+  uint64_t bytes;
+
+  while( count > 0 && idx < NUMROWS ) {
+
+    /* Delete Rest of Range Held by This Leaf */
+    off  = idx;
+    leaf = _findLeaf( &off, path, &depth );
+    leaf = _ownPath( path, depth );
+    k    = ( leaf->h.n - off < count ) ? leaf->h.n - off : count;
+    bytes = _leafBytes( leaf, off, off + k );
+
+    _moveRows( leaf, off, leaf, off + k, leaf->h.n - off - k );
+    leaf->h.n -= k;
+
+    for( d = 0; d<depth; d++ ) {
+      path[d].node->u.in.count[ path[d].slot ] -= k;
+      path[d].node->u.in.bytes[ path[d].slot ] -= bytes;
+    }
+    NUMROWS  -= k;
+    NUMBYTES -= bytes;
+    count   -= k;
+
+    if( leaf->h.n == 0 )
+      _removeChild( path, depth-1, leaf );
+    else if( leaf->h.n < LEAFMAX / 4 )
+      _joinSibling( path, depth-1 );
+  }
+
+  _collapseRoot();
+}
+
+
+/*****************************************************************************************
+				  LINE TABLE BYTE OFFSETS
+*****************************************************************************************/
+
+/* Text Bytes in Table */
+uint64_t getLineTableBytes( void ) {
+
+  return NUMBYTES;
+}
+
+/* Leaf Rows, Decoded Into lf If Packed, Without Changing the Tree */
+static const node_t *_readLeaf( const node_t *nd, node_t *lf ) {
+
+  if( !_head( nd )->packedP )
+    return nd;
+
+  _decodeRows( _packed( nd ), lf );
+  return lf;
+}
+
+/* Text Bytes Before Row idx */
+uint64_t getLineTableOffset( int idx ) {
+
+  int k;
+  uint64_t off = 0;
+  const node_t *nd = ROOT;
+  node_t lf;
+
+  if( idx >= NUMROWS ) return NUMBYTES;
+
+  while( !_head( nd )->leafP ) {
+    for( k = 0; k < nd->h.n - 1 && idx >= nd->u.in.count[k]; k++ ) {
+      idx -= nd->u.in.count[k];
+      off += nd->u.in.bytes[k];
+    }
+    nd = nd->u.in.kid[k];
+  }
+
+  return off + _leafBytes( _readLeaf( nd, &lf ), 0, idx );
+}
+
+/* Row Holding Byte *off, Which Becomes Its Offset in the Row */
+int findLineTableByte( uint64_t *off ) {
+
+  int k, row = 0;
+  const node_t *nd = ROOT;
+  node_t lf;
+  uint64_t len;
+
+  if( NUMROWS == 0 ) {
+    *off = 0;
+    return 0;
+  }
+
+  /* Past the End, Take the End of the Last Row */
+  if( *off >= NUMBYTES ) {
+    *off = NUMBYTES - getLineTableOffset( NUMROWS - 1 );
+    return NUMROWS - 1;
+  }
+
+  while( !_head( nd )->leafP ) {
+    for( k = 0; k < nd->h.n - 1 && *off >= nd->u.in.bytes[k]; k++ ) {
+      *off -= nd->u.in.bytes[k];
+      row  += nd->u.in.count[k];
+    }
+    nd = nd->u.in.kid[k];
+  }
+
+  nd = _readLeaf( nd, &lf );
+  for( k = 0; k < nd->h.n - 1; k++ ) {
+    len = nd->u.lf.len[k] & ~INLINEBIT;
+    if( *off < len ) break;
+    *off -= len;
+  }
+
+  return row + k;
+}
+
+
+/*****************************************************************************************
+				   LINE TABLE SNAPSHOTS
+*****************************************************************************************/
+
+/* Share the Current Rows, Until releaseLineSnap */
+lineSnap_t snapLineTable( void ) {
+
+  lineSnap_t snap = { ROOT, NUMROWS };
+
+  _head( ROOT )->ref++;
+  SNAPS++;
+
+  return snap;
+}
+
+static bool _walkNode( const node_t *nd, int first, bool (*visit)( row_t, void * ),
+		       void *arg ) {
+
+  int i;
+  node_t lf;
+
+  if( _head( nd )->packedP ) {		     /* Decode a Private Copy */
+    _decodeRows( _packed( nd ), &lf );
+    nd = &lf;
+  }
+
+  if( nd->h.leafP ) {
+    for( i = first; i<nd->h.n; i++ )
+      if( !visit( _getRow( nd, i ), arg ))
+	return false;
+  }
+  else {
+    for( i = 0; i<nd->h.n; i++ ) {
+
+      /* Skip Children Before first */
+      if( first >= nd->u.in.count[i] ) {
+	first -= nd->u.in.count[i];
+	continue;
+      }
+
+      if( !_walkNode( nd->u.in.kid[i], first, visit, arg ))
+	return false;
+      first = 0;
+    }
+  }
+
+  return true;
+}
+
+/***
+    Visit Snapshot Rows in Order From Row first, Stopping When visit
+    Returns false
+
+    Only reads the shared nodes, so another thread may walk a snapshot
+    while the editor changes the live table.
+***/
+bool walkLineSnap( lineSnap_t snap, int first, bool (*visit)( row_t, void * ), void *arg ) {
+
+  return _walkNode( snap.root, first, visit, arg );
+}
+
+/* Drop a Snapshot, Freeing Nodes Only It Still Held */
+void releaseLineSnap( lineSnap_t snap ) {
+
+  _unrefNode( snap.root );
+  SNAPS--;
+}
+
+
+/*****************************************************************************************
+				  LINE TABLE MEMORY
+*****************************************************************************************/
+
+/***
+    Pack the Leaves Holding No Row in first .. last
+
+    Waits for PACKMIN unpacked leaves, and for every snapshot to be
+    released, since packing rewrites nodes in place.  If packing left
+    the leaf slabs mostly free, the tree moves into fresh slabs so the
+    old blocks can go.
+***/
+void packLineTable( int first, int last ) {
+
+  if( SNAPS > 0 || _head( ROOT )->leafP || LEAVES.live < PACKMIN )
+    return;
+
+  _compactPacks();
+  _packNode( ROOT, 0, first, last );
+  FINGER.leaf = NULL;
+
+  if( LEAVES.live * LEAVES.size * 2 < slabBytes( &LEAVES ))
+    _moveTree();
+}
+
+/* Sizes for the Memory Report */
+void getLineTableMemory( lineMem_t *m ) {
+
+  m->leaves      = LEAVES.live;
+  m->slabBytes   = slabBytes( &LEAVES ) + slabBytes( &NODES );
+  m->packed      = PACKS.live;
+  m->packedBytes = PACKS.bytes + PACKS.live * offsetof( node_t, u );
+  m->fullBytes   = PACKS.live * LEAVES.size;
+  m->decodes     = PACKS.decodes;
+  m->decodeSecs  = PACKS.decodeSecs;
+}
+
+
+/***
+    Local Variables:
+    mode: c
+    tags-file-name: "~/ae/TAGS"
+    comment-column: 45
+    fill-column: 90
+    End:
+ ***/
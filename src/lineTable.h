@@ -0,0 +1,42 @@
+/* Line Table Snapshot */
+typedef struct {
+  struct _node *root;			/* Shared Tree */
+  int rows;				/* Rows in Snapshot */
+} lineSnap_t;
+
+/* Line Table Management */
+void initializeLineTable( void );
+void freeLineTable( void );
+
+/* Line Table Rows */
+int getLineTableRows( void );
+row_t getLineTableRow( int );
+void setLineTableRow( int, row_t );
+void insertLineTableRow( int, row_t );
+void insertLineTableRows( int, const row_t *, int );
+void appendLineTableRow( row_t );
+void deleteLineTableRows( int, int );
+
+/* Line Table Byte Offsets */
+uint64_t getLineTableBytes( void );
+uint64_t getLineTableOffset( int );
+int findLineTableByte( uint64_t * );
+
+/* Line Table Snapshots */
+lineSnap_t snapLineTable( void );
+bool walkLineSnap( lineSnap_t, int, bool (*)( row_t, void * ), void * );
+void releaseLineSnap( lineSnap_t );
+
+/* Line Table Memory */
+typedef struct {
+  size_t leaves;			/* Unpacked Leaves */
+  size_t slabBytes;			/* Node Slabs Reserved */
+  size_t packed;			/* Packed Leaves */
+  size_t packedBytes;			/* Held by Packed Leaves */
+  size_t fullBytes;			/* Same Leaves, Unpacked */
+  unsigned long decodes;		/* Leaves Unpacked */
+  double decodeSecs;
+} lineMem_t;
+
+void packLineTable( int, int );
+void getLineTableMemory( lineMem_t * );
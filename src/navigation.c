@@ -24,6 +24,7 @@
 ==========================================================================================
  ***/
 #include <stdlib.h>
+#include <limits.h>
 #include <string.h>
 #include <stdbool.h>
 #include <curses.h>
@@ -36,6 +37,7 @@
 #include "minibuffer.h"
 #include "keyPress.h"
 #include "navigation.h"
+#include "colMap.h"
 
 #define screenRows() (getWinNumRows() - 3)
 #define thisRow() (getRowOffset() + getPointY())
@@ -56,29 +58,40 @@ static bool SEARCHINGP = false;
 ==========================================================================================
 ***/
 
+/* Put Point on Byte col of This Line, Scrolling Until Its Display Column Shows */
+static void _pointToCol( int col ) {
+
+  int row  = thisRow();
+  int co   = getColOffset();
+  int max  = getWinNumCols() - 1;
+  int dcol = getDisplayCol( row, col );
+
+  if( co > col )
+    co = col;
+
+  /* Least Offset Showing col, Found by Display Column */
+  if( dcol - getDisplayCol( row, co ) > max ) {
+    co = getDisplayByte( row, dcol - max );
+    if( getDisplayCol( row, co ) < dcol - max )
+      co++;
+  }
+
+  setColOffset( co );
+  setPointX( col - co );
+}
+
 /* Move Point Forward */
 void pointForward( void ) {
 
-  int PtX     = getPointX();
-  
-  if( thisCol() < getBufferLineLen( thisRow() ) - 1 ) {
-    if( PtX < getWinNumCols() - 1 )
-      setPointX( ++PtX );
-    else
-      setColOffset( getColOffset() + 1 );
-  }
+  if( thisCol() < getBufferLineLen( thisRow() ) - 1 )
+    _pointToCol( thisCol() + 1 );
 }
 
 /* Move Point Backward */
 void pointBackward( void ) {
 
-  int PtX = getPointX();
-  
   if( thisCol() > 0 ) {
-    if( PtX == 0 )
-      setColOffset( getColOffset() - 1 );
-    else
-      setPointX( --PtX );
+    _pointToCol( thisCol() - 1 );
   }
   else {
     if( getBufferRow() > 0 ) {
@@ -90,18 +103,8 @@ void pointBackward( void ) {
 /* Move Point to End of Line */
 void pointToEndLine() {
 
-  int thisRow = thisRow();
-  int x = getBufferLineLen( thisRow ) - 1;   /* Text Line Length */
-  int y = getWinNumCols() - 1;                     /* Terminal Length */
-
-  if( x > y ) {
-    setPointX( y );
-    setColOffset( x - y );
-  }
-  else {
-    setPointX( x );
-    setColOffset( 0 );
-  }
+  setColOffset( 0 );
+  _pointToCol( getBufferLineLen( thisRow() ) - 1 );
 }
 
 
@@ -111,31 +114,39 @@ void pointToEndLine() {
 ==========================================================================================
 ***/
 
+/* First Column From col Whose Char Is (inP) or Is Not in set, Else EOL */
+static int _scanForward( int row, int col, const char *set, bool inP ) {
+
+  int i, span;
+  int eol = getBufferLineLen( row ) - 1;
+  char *txt;
+
+  /* Scan the Line Text a Span at a Time */
+  while( col < eol ) {
+    txt = getBufferTextSpan( row, col, &span );
+    for( i = 0; i < span && col + i < eol; i++ )
+      if(( memchr( set, txt[i], strlen( set )) != NULL ) == inP )
+	return col + i;
+    col += span;
+  }
+
+  return eol;
+}
+
 /* Forward Word */
 void forwardWord( void ) {
 
-  char c;
+  int row = thisRow();
+  int col = thisCol();
   
-  if( thisCol() == getBufferLineLen( thisRow() ) - 1 ) /* At EOL? */
+  if( col >= getBufferLineLen( row ) - 1 ) /* At EOL? */
     return;
 
-  pointForward();
-
- /* Move Past Spaces */
-  while(( c = getBufferChar( thisRow(), thisCol() )) == ' ' ) 
-    pointForward();
-
-  /* Move to End of Word */
-  while( c != '\n' &&
-         c != ' '  &&
-         c != ')'  &&
-         c != ']' ) {
-
-    pointForward();
-    c = getBufferChar( thisRow(), thisCol() );
-  }
+  /* Move Past Spaces, Then to End of Word */
+  col = _scanForward( row, col + 1, " ", false );
+  col = _scanForward( row, col, "\n )]", true );
 
-  return;
+  _pointToCol( col );
 }
 
 
@@ -143,49 +154,69 @@ void forwardWord( void ) {
 void backwardWord( void ) {
 
   char c;
+  int row = thisRow();
+  int col = thisCol();
   
-  if( thisCol() == 0 ) return;        /* At BOL? */
+  if( col == 0 ) return;	      /* At BOL? */
 
-  int old_POINT_X = getPointX();
-  pointBackward();
-  
- /* Move Past Spaces */
-  c = getBufferChar( thisRow(), thisCol() );
+  /* Move Past Spaces */
+  c = getBufferChar( row, --col );
   while(( c == ' '   ||
           c == ')'   ||
           c == ';'   ||
           c == ']' ) &&
-        thisCol() > 0 ) {
-    
-    pointBackward();
-    c = getBufferChar( thisRow(), thisCol() );
-  }
+        col > 0 )
+    c = getBufferChar( row, --col );
 
-  /* If POINT_X is a Space, No Prior Word this Line */
-  if( c == ' ' ) {
-    setPointX( old_POINT_X );
+  /* If POINT is on a Space, No Prior Word this Line */
+  if( c == ' ' )
     return;
-  }
   
- /* Move to Beginning of Word */
-  c = getBufferChar( thisRow(), thisCol() );
-  while( thisCol() > 0                            &&
+  /* Move to Beginning of Word */
+  while( col > 0   &&
          c != ' '  &&
          c != '('  &&
-         c != '[' ) {
-    pointBackward();
-    c = getBufferChar( thisRow(), thisCol() );
-  }
+         c != '[' )
+    c = getBufferChar( row, --col );
 
- /* Don't Leave POINT on a Space */
+  /* Don't Leave POINT on a Space */
   if( c == ' ' )
-    pointForward();
+    col++;
+
+  _pointToCol( col );
+}
+
+/* Find First Match in Text of Length len */
+static char *_firstMatch( char *txt, int len ) {
+
+  int srchLen = strlen( _SRCH_STR );
+
+  for( int i = 0; i <= len - srchLen; i++ ) {
+    if( memcmp( txt + i, _SRCH_STR, srchLen ) == 0 )
+      return txt + i;
+  }
+
+  return NULL;
+}
+
+/* Find Last Match in Text of Length len */
+static char *_lastMatch( char *txt, int len ) {
+
+  int srchLen = strlen( _SRCH_STR );
+
+  for( int i = len - srchLen; i >= 0; i-- ) {
+    if( memcmp( txt + i, _SRCH_STR, srchLen ) == 0 )
+      return txt + i;
+  }
+
+  return NULL;
 }
 
 /* Search FORWARD for a Word */
 void wordSearchForward( void ) {
 
   char *txt, *match;
+  int len;
   
   int row     = getBufferRow();
   int nRow    = getBufferNumRows();
@@ -206,12 +237,14 @@ void wordSearchForward( void ) {
     
     /* Search From Current Row Forward */
     txt = getBufferTextLine( row );
+    len = getBufferLineLen( row );
     if( row == getBufferRow() ) {	     /* Skip Past Current POINT */
       pad = getPointX() + getColOffset() + 1;
       txt += pad;
+      len -= pad;
     }
 
-    match = strstr( txt, _SRCH_STR );
+    match = _firstMatch( txt, len );
 
     /* Match Found */
     if( match ) {			     
@@ -238,23 +271,11 @@ void wordSearchForward( void ) {
   return;
 }
 
-/* Find Last Match in Text String */
-char *_lastMatch( char *str ) {
-
-  char *lastMatch = NULL;
-
-  while(( str = strstr( str, _SRCH_STR )) != NULL ) {
-    lastMatch = str;
-    str++;
-  }
-
-  return lastMatch;
-}
-
 /* Search BACKWARD for a Word */
 void wordSearchBackward( void ) {
 
-  char *txt, *match, *tmp;
+  char *txt, *match;
+  int len;
   
   int row     = getBufferRow();
   bool matchP = false;
@@ -270,35 +291,15 @@ void wordSearchBackward( void ) {
   /* Search for search string in buffer lines */
   for( ; row >= 0; row-- ) {
 
-    tmp = NULL;
-    
-    /* Search From Current Row Forward */
     txt = getBufferTextLine( row );
-    int eol = 0;			     /* Only EOL Cutoff for Active Row  */
-
-    /* Skip Short Lines */
-    if( strlen( txt ) < strlen( _SRCH_STR )) continue;
+    len = getBufferLineLen( row );
 
     /* Only Search Up to POINT on Current Line */
-    if( row == getBufferRow() ) {	     
-
-      if(( eol = getBufferCol() ) < (int)strlen( _SRCH_STR )) continue;
-      
-      if(( tmp = malloc( sizeof( char ) * ( eol + 1))) == NULL ) {
-	miniBufferMessage( "Search Failed: Memory Error!" );
-	return;
-      }
-
-      /* Create a tmp string that does not include last half of line */
-      strncpy( tmp, txt, eol-1 );
-      tmp[eol] = '\0';
-      txt = tmp;
-    }
+    if( row == getBufferRow() )
+      len = getBufferCol();
 
-    match = _lastMatch( txt );
+    match = _lastMatch( txt, len );
 
-    if( tmp ) free( tmp );
-      
     /* Match Found */
     if( match ) {			     
 
@@ -351,6 +352,7 @@ void nextLine() {
     
     if(( getPointX() + co ) >
        getBufferLineLen( PtY + ro )) pointToEndLine();
+    else _pointToCol( thisCol() );
   }
 }
 
@@ -366,6 +368,16 @@ void priorLine() {
   
   if(( getPointX() + co ) >
      getBufferLineLen( PtY + ro )) pointToEndLine();
+  else _pointToCol( thisCol() );
+}
+
+
+/* Move Point n Lines, Up If n < 0, in One Jump */
+void moveLines( int n ) {
+
+  long row = (long)thisRow() + n;
+
+  pointToRowCol( row < 0 ? 0 : ( row > INT_MAX ? INT_MAX : (int)row ), thisCol() );
 }
 
 
@@ -432,6 +444,8 @@ void pageDown( void ) {
 
   int PtY = getPointY();
   int sr  = screenRows();
+
+  prefetchBufferRows( getRowOffset() + sr, 2 * sr );
   
   /* Point NOT at bottom of Terminal */
   if( PtY < sr ) {
@@ -461,6 +475,8 @@ void pageUp( void ) {
 
   int PtY = getPointY();
   int ro  = getRowOffset();
+
+  prefetchBufferRows( ro - 2 * screenRows(), 2 * screenRows() );
   
   /* Point NOT at top of terminal */
   if( PtY > 0 ) {
@@ -509,6 +525,71 @@ void jumpToLine( void ) {
   _goto( lineNum );
 }
 
+/* Put Point on Byte col of row, Scrolling Only If row is Off Screen */
+void pointToRowCol( int row, int col ) {
+
+  int nr  = getBufferNumRows();
+  int eol;
+
+  if( row >= nr ) row = nr - 1;
+  if( row < 0 )   row = 0;
+
+  if( row >= getRowOffset() && row <= getRowOffset() + screenRows() )
+    setPointY( row - getRowOffset() );
+  else
+    _goto( row + 1 );
+
+  eol = getBufferLineLen( row ) - 1;
+
+  setColOffset( 0 );
+  _pointToCol( col < eol ? col : ( eol > 0 ? eol : 0 ));
+}
+
+/* Put Point on Buffer Byte off */
+static void _gotoByte( size_t off ) {
+
+  int row = findBufferByte( &off );
+
+  pointToRowCol( row, off < (size_t)INT_MAX ? (int)off : INT_MAX );
+}
+
+/* Move Point n Bytes, Back If n < 0, in One Jump */
+void moveChars( int n ) {
+
+  size_t off = getBufferOffset( thisRow(), thisCol() );
+
+  if( n < 0 )
+    off = ( (size_t)-(long)n > off ) ? 0 : off - (size_t)-(long)n;
+  else
+    off += (size_t)n;
+
+  _gotoByte( off );
+}
+
+/* Jump to <input> Byte Offset, Counted From 0 */
+void jumpToByte( void ) {
+
+  char *end;
+  unsigned long long off;
+
+  if( !miniBufferGetInput( "Byte: " )) return;
+
+  off = strtoull( miniBufferGetUserText(), &end, 10 );
+  if( end == miniBufferGetUserText()) return;
+
+  _gotoByte( (size_t)off );
+}
+
+/* Jump to <input> Percent of the Buffer */
+void jumpToPercent( void ) {
+
+  int pct = miniBufferGetPosInteger( "Percent: " );
+
+  if( pct < 0 || pct > 100 ) return;
+
+  _gotoByte( (size_t)( getBufferBytes() * ( pct / 100.0 )));
+}
+
 /***
     Local Variables:
     mode: c
@@ -13,6 +13,7 @@ void clearSearchFlag( void );
 /* Line Navigation */
 void nextLine( void );
 void priorLine( void );
+void moveLines( int );
 void centerLine( void );
 
 /* Buffer Navigation */
@@ -20,3 +21,7 @@ void pageDown( void );
 void pageUp( void );
 void pointToEndBuffer( void );
 void jumpToLine( void );
+void jumpToByte( void );
+void jumpToPercent( void );
+void pointToRowCol( int, int );
+void moveChars( int );
@@ -177,6 +177,12 @@ bool inRegionP( int row, int col ) {
 static void _removeText( int strt_Col, int strt_Row,
 			 int stop_Col, int stop_Row ) {
 
+  /* Delete Lines Between Start/End in One Pass */
+  if( stop_Row - strt_Row > 1 ) {
+    freeBufferLines( strt_Row + 1, stop_Row - strt_Row - 1 );
+    stop_Row = strt_Row + 1;
+  }
+
   /* Loop Over Rows in Region */ 
   int row = strt_Row;
   do {
@@ -209,6 +215,7 @@ static void _removeText( int strt_Col, int strt_Row,
 	else
 	  setBufferGapPtrs( row, strt_Col, stop_Col );
 
+	setPointY( row-getRowOffset() );
 	updateLine();
 	++row;
       }
@@ -236,7 +243,7 @@ static void _removeText( int strt_Col, int strt_Row,
 	setBufferGapPtrs( row, 0, stop_Col );
 
 	/* Delete Line Up to Mark */
-	setPointY( strt_Row-getRowOffset() );
+	setPointY( row-getRowOffset() );
 	updateLine();
 
 	/* Combine With First Line, IFF Not Deleted */
@@ -251,29 +258,69 @@ static void _removeText( int strt_Col, int strt_Row,
 }
 
 
+/* Order Point and Mark as the Start and Stop of the Region */
+static void _regionBounds( int *strt_X, int *strt_Y, int *stop_X, int *stop_Y ) {
+
+  int temp_X, temp_Y;
+
+  *strt_X = getPointX() + getColOffset(); 
+  *strt_Y = getPointY() + getRowOffset();
+  *stop_X = getMarkX();
+  *stop_Y = getMarkY();
+
+  if((  *stop_Y <  *strt_Y ) ||
+     (( *stop_Y == *strt_Y ) && ( *stop_X < *strt_X ))) {
+
+    temp_X  = *strt_X;
+    temp_Y  = *strt_Y;
+    *strt_X = *stop_X;
+    *strt_Y = *stop_Y;
+    *stop_X = temp_X;
+    *stop_Y = temp_Y;
+  }
+}
+
+/***
+    Save the Text _removeText Takes in the Kill Ring
+
+    From column 0 to the end of a later line, the last line goes whole,
+    newline and all.  From inside a line to column 0 of a later one,
+    the newline before the stop stays.
+***/
+static void _killText( int strt_Col, int strt_Row, int stop_Col, int stop_Row ) {
+
+  if( stop_Row > strt_Row ) {
+
+    if(( strt_Col == 0 ) && ( stop_Col == getBufferLineLen( stop_Row ) - 1 )) {
+      ++stop_Row;
+      stop_Col = 0;
+    }
+
+    else if(( strt_Col > 0 ) && ( stop_Col == 0 )) {
+      --stop_Row;
+      stop_Col = getBufferLineLen( stop_Row ) - 1;
+    }
+  }
+
+  pushKillRegion( strt_Row, strt_Col, stop_Row, stop_Col );
+}
+
+
 /* Kill Text Between Point and Mark */
 void killRegion() {
 
-  int temp_X, temp_Y;
-  
-  int strt_X = getPointX() + getColOffset(); 
-  int strt_Y = getPointY() + getRowOffset();
-  int stop_X = getMarkX();
-  int stop_Y = getMarkY();
+  int temp_Y;
+  int strt_X, strt_Y, stop_X, stop_Y;
+
+  /* Save Prior Unsaved Changes to Text Row */
+  if( bufferRowEditedP( getBufferRow() ))
+    updateNavigationState();
 
   /* Define Start/Stop Deletion Region */
-  if((  stop_Y <  strt_Y ) ||
-     (( stop_Y == strt_Y ) && ( stop_X < strt_X ))) {
-
-    temp_X = strt_X;
-    temp_Y = strt_Y;
-    strt_X = stop_X;
-    strt_Y = stop_Y;
-    stop_X = temp_X;
-    stop_Y = temp_Y;
-  }
+  _regionBounds( &strt_X, &strt_Y, &stop_X, &stop_Y );
 
-  /* Remove Text/Textlines */
+  /* Remove Text/Textlines, Saving Them First */
+  _killText( strt_X, strt_Y, stop_X, stop_Y );
   _removeText( strt_X, strt_Y, stop_X, stop_Y );
 
 
@@ -291,6 +338,29 @@ void killRegion() {
 }
 
 
+/* Copy Text Between Point and Mark to the Kill Ring */
+void copyRegion( void ) {
+
+  int strt_X, strt_Y, stop_X, stop_Y;
+
+  if( MARK_X == -1 || MARK_Y == -1 ) {
+    miniBufferMessage( "Mark not set" );
+    return;
+  }
+
+  _regionBounds( &strt_X, &strt_Y, &stop_X, &stop_Y );
+
+  if( pushKillRegion( strt_Y, strt_X, stop_Y, stop_X ))
+    miniBufferMessage( "Copied Region" );
+  else
+    miniBufferMessage( "Region is empty" );
+
+  setRegionActive( false );
+
+  return;
+}
+
+
 /***
     Local Variables:
     mode: c
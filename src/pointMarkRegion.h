@@ -14,3 +14,4 @@ void setRegionActive( bool );
 bool regionActiveP( void );
 bool inRegionP( int, int );
 void killRegion( void );
+void copyRegion( void );
@@ -34,9 +34,64 @@
 #include "edit.h"
 #include "window.h"
 #include "files.h"
+#include "colMap.h"
 
 #define DISPLAY_ROWS ( getWinNumRows() - 2 )
 
+/*******************************************************************************
+                            DISPLAY COLUMNS
+*******************************************************************************/
+
+/* Char col of row, Reading Unsaved Edit Buffer Text Into the Gap */
+static char _editRowChar( int row, int col ) {
+
+  int gapL = getBufferGapLeftIndex( row );
+  int ebi  = getEditBufferIndex();
+
+  if( col < gapL )
+    return getBufferChar( row, col );
+
+  if( col < gapL + ebi )
+    return getEditBufferChar( col - gapL );
+
+  return getBufferChar( row, getBufferGapRightIndex( row ) + col - gapL - ebi );
+}
+
+/* Display Column of col on row, As the Row Is Shown While Editing */
+static int _pointDisplayCol( int row, int col ) {
+
+  int i, dcol;
+  int gapL = getBufferGapLeftIndex( row );
+
+  if( !bufferRowEditedP( row ) || col <= gapL )
+    return getDisplayCol( row, col );
+
+  dcol = getDisplayCol( row, gapL );
+  for( i = gapL; i < col; i++ )
+    dcol = nextDisplayCol( dcol, _editRowChar( row, i ));
+
+  return dcol;
+}
+
+/* Draw c at Display Column col Less hOff, Return the Next Column */
+static int _drawChar( int row, int col, int hOff, char c ) {
+
+  int next = nextDisplayCol( col, c );
+
+  /* Newline Clears Rest of Row */
+  if( c == '\n' ) {
+    mvaddch( row, col > hOff ? col - hOff : 0, c );
+    return next;
+  }
+
+  for( ; col < next; col++ )
+    if( col >= hOff )
+      mvaddch( row, col - hOff, c == '\t' ? ' ' : c );
+
+  return next;
+}
+
+
 /*******************************************************************************
                              RENDER TEXT
 *******************************************************************************/
@@ -45,10 +100,12 @@
 void renderText( void ) {
 
   int i, j;				     /* Iteration Indices */
-  int row, col;				     /* Row/Col Being Processed */
+  int row, col;				     /* Row/Display Col Being Processed */
   int nextRow;				     /* The Next Row to Process */
-  int colMax;				     /* Last Col Index Dispalyed in Window */
   int txtLen;				     /* Length of Text to Display on Line */
+  bool editP;				     /* Row Has Unsaved Edits */
+  char *txt = NULL;			     /* Span of Row Text From Byte at */
+  int at, span;				     /* Start and Length of Span */
 
   /* Row/Column Initializations */
   int colOffset = getColOffset();
@@ -60,6 +117,13 @@ void renderText( void ) {
   int fileRows = getBufferNumRows();
   int maxCols  = getWinNumCols();
 
+  /* Display Columns of POINT and of the Left Window Edge */
+  int pointCol = _pointDisplayCol( thisRow, thisCol );
+  int hOff     = _pointDisplayCol( thisRow, colOffset );
+
+  if( pointCol - hOff > maxCols - 1 )	     /* Keep POINT on Screen */
+    hOff = pointCol - ( maxCols - 1 );
+
   /* Iter Across Each Row of Visible Screen */
   for( row = 0; row < DISPLAY_ROWS; row++ ) {
 
@@ -67,58 +131,59 @@ void renderText( void ) {
 
     if( nextRow < fileRows ) {		     /* Write Buffer Text */
 
-      /* Calc How Much of the Text Row Should Be Displayed */
-      txtLen = getBufferLineLen( nextRow ) - colOffset;
+      editP = ( nextRow == thisRow && bufferRowEditedP( nextRow ));
+
+      /* Start at First Char in Window, Edited Row No Later Than Its Gap */
+      i = getDisplayByte( nextRow, hOff );
+      if( editP && i > getBufferGapLeftIndex( nextRow ))
+	i = getBufferGapLeftIndex( nextRow );
+      col = getDisplayCol( nextRow, i );
 
-      /* Calculate what subset of that Text Row Fits in the Term Window */
-      colMax = maxCols > txtLen ? txtLen : maxCols;
+      /* Read Only the Text in the Window */
+      txtLen = getBufferLineLen( nextRow );
+      at     = i;
+      span   = 0;
 
       /* Write Letter at a Time */
-      col = 0;
-      for( i=0; i < colMax; i++ ) {
+      for( ; i < txtLen && col < hOff + maxCols; i++ ) {
+
+	if( i >= at + span ) {
+	  at  = i;
+	  txt = getBufferTextSpan( nextRow, at, &span );
+	}
 
         /* Insert EDIT BUFFER Chars */
-        if( nextRow == thisRow                   &&
-	    bufferRowEditedP( nextRow )          &&
+        if( editP                                &&
 	    ( getBufferGapSize( nextRow ) == 0 ) &&
             ( i == getBufferGapLeftIndex( nextRow ))) {
 
 	  /* Highlight, If Rendering Active Region */
-          if( inRegionP( nextRow, i+colOffset ))
+          if( inRegionP( nextRow, i ))
 	    attron( COLOR_PAIR( HIGHLT_BACKGROUND ));
 
 	  /* Insert EEDIT BUFFER Chars */
-          for( j = 0; j<getEditBufferIndex(); j++ ) {
-            mvaddch( row, col, getEditBufferChar(j) );
-            col++;
-          }
-
-	  // NOT SURE IF THIS DOES ANYTHING...
-	  /* Highlight, If Rendering Active Region */
-          //if( inRegionP( nextRow, i+colOffset ))
-	  //attron( COLOR_PAIR( HIGHLT_BACKGROUND ));
+          for( j = 0; j<getEditBufferIndex(); j++ )
+            col = _drawChar( row, col, hOff, getEditBufferChar(j) );
 
-          mvaddch( row, col, getBufferChar( nextRow, i+colOffset ));
-          col++;
+          col = _drawChar( row, col, hOff, txt[i-at] );
 	  attroff( COLOR_PAIR( HIGHLT_BACKGROUND ));
         }
 
         /* Ignore Chars In Line Buffer Gap */
-        else if( nextRow == thisRow                    &&
-		 bufferRowEditedP( nextRow )           &&
+        else if( editP                                 &&
 		 i >= getBufferGapLeftIndex( nextRow ) &&
 		 i <  getBufferGapRightIndex(nextRow )) {
 
+	  i = getBufferGapRightIndex( nextRow ) - 1;
 	  continue;
         }
 
         /* Insert Line Buffer Chars */
         else {
-          if( inRegionP( nextRow, i+colOffset ))
+          if( inRegionP( nextRow, i ))
 	    attron( COLOR_PAIR( HIGHLT_BACKGROUND ));
 
-          mvaddch( row, col, getBufferChar( nextRow, i+colOffset ));
-          col++;
+          col = _drawChar( row, col, hOff, txt[i-at] );
 
 	  attroff( COLOR_PAIR( HIGHLT_BACKGROUND ));
         }
@@ -136,9 +201,10 @@ void renderText( void ) {
   drawStatusLine( getBufferFilename(),
 		  getStatusFlagName(),
 		  thisRow, fileRows,
-		  thisCol, getBufferLineLen( thisRow ));
+		  pointCol, getDisplayCol( thisRow, getBufferLineLen( thisRow ) - 1 ) + 1,
+		  getBufferOffset( thisRow, thisCol ), getBufferBytes() );
 
-  move( getPointY(), getPointX() );	     /* Set POINT */
+  move( getPointY(), pointCol - hOff );	     /* Set POINT */
   refresh();
 }
 
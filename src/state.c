@@ -23,7 +23,6 @@
 
 ==========================================================================================
  ***/
-#include <stdlib.h>
 #include <stdbool.h>
 
 #include "ae.h"
@@ -48,6 +47,7 @@ static const char _sfname[3][9] = { "ORIGINAL", "MODIFIED", "READONLY" };
 
 /* Is Buffer Modified? */
 static enum _sf STATUSFLAG = ORIGINAL;		
+static unsigned long MODIFICATIONS = 0;	     /* Times Flagged Modified */
 
 /*****************************************************************************************
 				  GET/SET BUFFER STATUS
@@ -60,6 +60,18 @@ void setStatusFlagOriginal( void ) {
 
 void setStatusFlagModified( void ) {
   STATUSFLAG = MODIFIED;
+  MODIFICATIONS++;
+}
+
+void setStatusFlagReadOnly( void ) {
+
+  STATUSFLAG = READONLY;
+}
+
+/* Changes When the Buffer is Flagged Modified, Even If Already So */
+unsigned long getStatusFlagModifications( void ) {
+
+  return MODIFICATIONS;
 }
 
 bool statusFlagModifiedP( void ) {
@@ -67,6 +79,11 @@ bool statusFlagModifiedP( void ) {
   return ( STATUSFLAG == MODIFIED );
 }
 
+bool statusFlagReadOnlyP( void ) {
+
+  return ( STATUSFLAG == READONLY );
+}
+
 char *getStatusFlagName( void ) {
 
   return (char *)_sfname[ STATUSFLAG ];
@@ -97,46 +114,14 @@ void setColOffset( int co ) {
 /* Incorporate Edits Into Row Structure */
 void updateLine( void ) {
 
-  char *tmp;                        /* New Text Row */
-
-  int i   = 0;
-  int thisCol = 0;
   int thisRow = thisRow();
   
-  int ebIndex    = getEditBufferIndex();
-  int oldLineLen = getBufferLineLen( thisRow );
-
-  /* Calculate Size of New Line */
-  int delta = ebIndex - getBufferGapSize( thisRow );
-
-  int newLineLen = oldLineLen + delta; 
-    
-  /* Allocate Heap Space for New Line */
-  if(( tmp = malloc(( sizeof( char ) * newLineLen ) + 1 )) == NULL )
-    die( "updateLine: tmp malloc failed" );
-
-  /* Copy Non-deleted Chars */
-  for( i = 0; i<getBufferGapLeftIndex( thisRow ); i++ ) {
-    tmp[thisCol] = getBufferChar( thisRow, i );
-    thisCol++;
-  }
-
-  /* Add Chars from Edit Buffer */
-  for( i = 0; i<ebIndex; i++ ) {
-    tmp[thisCol] = getEditBufferChar(i);
-    thisCol++;
-  }
-
-  /* Add Rest of Chars */
-  for( i = getBufferGapRightIndex( thisRow ); i<oldLineLen; i++ ) {
-    tmp[thisCol] = getBufferChar( thisRow, i );
-    thisCol++;
-  }
-
-  tmp[newLineLen] = '\0';		     /* NULL Terminate New String */
-
-  /* Update Text in Buffer Line */
-  replaceBufferLineText( thisRow, newLineLen, tmp );
+  /* Replace Line Gap With Edit Buffer Text */
+  spliceBufferLineText( thisRow,
+			getBufferGapLeftIndex( thisRow ),
+			getBufferGapRightIndex( thisRow ),
+			getEditBufferPtr(),
+			getEditBufferIndex() );
 
   /* Clear Edit Buffer */
   setEditBufferIndex( 0 );
@@ -1,6 +1,9 @@
 void setStatusFlagOriginal( void );
 void setStatusFlagModified( void );
+void setStatusFlagReadOnly( void );
 bool statusFlagModifiedP( void );
+bool statusFlagReadOnlyP( void );
+unsigned long getStatusFlagModifications( void );
 char *getStatusFlagName( void );
 int getRowOffset( void );
 int getColOffset( void );
@@ -40,7 +40,8 @@ static char statusLine[256];
 /* Draw Status Line */
 void drawStatusLine( char *fn, const char *status,
 		     int row, int numRows,
-		     int col, int numCols ) {
+		     int col, int numCols,
+		     size_t byte, size_t numBytes ) {
 
   //return;
   
@@ -52,8 +53,9 @@ void drawStatusLine( char *fn, const char *status,
   attron( A_REVERSE );                /* Reverse Video */
 
   snprintf( statusLine, maxX > 256 ? 256 : maxX  - 1,
-            "--[ %s ]-------(%s)------- Row %d of %d ------- Col %d of %d ------- F1 for Help --- F10 to Quit",
-            fn, status, row+1, numRows, col+1, numCols );
+            "--[ %s ]-------(%s)------- Row %d of %d ------- Col %d of %d ------- Byte %zu (%d%%) ------- F1 for Help --- F10 to Quit",
+            fn, status, row+1, numRows, col+1, numCols,
+            byte, byte < numBytes ? (int)( byte * 100.0 / numBytes ) : 100 );
 
   mvaddstr( curRow, 0, statusLine );
 
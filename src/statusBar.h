@@ -1 +1 @@
-void drawStatusLine( char *, const char *, int, int, int, int );
+void drawStatusLine( char *, const char *, int, int, int, int, size_t, size_t );
@@ -0,0 +1,536 @@
+/***
+==========================================================================================
+                      _              _         _____    _ _ _
+                     / \   _ __   __| |_   _  | ____|__| (_) |_
+                    / _ \ | '_ \ / _` | | | | |  _| / _` | | __|
+                   / ___ \| | | | (_| | |_| | | |__| (_| | | |_
+                  /_/   \_\_| |_|\__,_|\__, | |_____\__,_|_|\__|  v0.5-beta
+                                       |___/
+
+        Copyright 2020 (andrew.suttles@gmail.com)
+        MIT LICENSE
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+ INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE 
+ LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT 
+ OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ DEALINGS IN THE SOFTWARE.
+
+ AndyEDIT is a simple, line-oriented, terminal-based text editor with emacs-like keybindings.
+
+ For more information about AndyEdit, see README.md.
+
+==========================================================================================
+ ***/
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ae.h"
+#include "arena.h"
+#include "buffer.h"
+#include "minibuffer.h"
+#include "navigation.h"
+#include "pointMarkRegion.h"
+#include "state.h"
+#include "undo.h"
+
+/***
+    Undo Log
+
+    The buffer reports each change it makes as its inverse.  A splice
+    keeps the bytes it removed.  Deleted rows keep their row_t
+    descriptors, not their text, so undoing the kill of a 100k line
+    region restores 100k descriptors.  Inserted rows keep only a count.
+    Records are packed end to end in one growable block per log.
+
+    Each command is a step: undo reverts every record of the last step
+    and redo replays what undo reverted.  Typing, backspacing and
+    deleting forward on one line extend the last record rather than
+    add one, so a run of them is undone at once.  Any other change
+    empties the redo log.
+
+    Both logs together stay under $AE_UNDO bytes (default an eighth of
+    the memory budget, 0 turns undo off).  Past it, the oldest steps are
+    dropped at the next command.
+***/
+
+/* Record Operations */
+enum _uop { USPLICE, UINSERT, UDELETE };
+
+/* Who Is Changing the Buffer */
+enum _um { UNORMAL, UUNDO, UREDO };
+
+/* Record Header, size Bytes of Payload Follow */
+typedef struct {
+  uint32_t op;
+  uint32_t pad;
+  size_t   size;			     /* Removed Text, or Held Rows */
+  unsigned long step;			     /* Command That Made It */
+  int      row;
+  int      left;			     /* First Column Spliced */
+  int      len;				     /* Bytes Spliced In, or Rows */
+} urec_t;
+
+/* Records Padded to Keep Payloads Aligned */
+#define PADDED(n) ((( n ) + 7 ) & ~(size_t)7 )
+
+/* Growable Record Log */
+typedef struct {
+  char   *buf;				     /* Records, End to End */
+  size_t  used;
+  size_t  max;
+  size_t *at;				     /* Offset of Each Record */
+  int     n;
+  int     maxN;
+} ulog_t;
+
+/* Module Private Data */
+static ulog_t UNDO, REDO;
+
+static struct {
+  bool     onP;				     /* Recording Buffer Changes */
+  enum _um mode;
+  unsigned long step;
+  size_t   budget;			     /* Bytes Both Logs May Hold */
+  bool     droppedP;			     /* Steps Dropped Over Budget */
+} U = { .onP = false, .mode = UNORMAL };
+
+
+/*****************************************************************************************
+				       RECORD LOGS
+*****************************************************************************************/
+
+/* Undo Budget From $AE_UNDO, e.g. 64M */
+static size_t _undoBudget( void ) {
+
+  char *env, *end;
+  double n;
+
+  if(( env = getenv( "AE_UNDO" )) == NULL ||
+     ( n = strtod( env, &end )) < 0 || end == env )
+    return getMemoryBudget() / 8;
+
+  switch( *end ) {
+  case 'g': case 'G': n *= 1024;	     /* Fall Through */
+  case 'm': case 'M': n *= 1024;	     /* Fall Through */
+  case 'k': case 'K': n *= 1024;
+  }
+
+  return (size_t)n;
+}
+
+static urec_t *_record( ulog_t *log, int i ) {
+
+  return (urec_t *)( log->buf + log->at[i] );
+}
+
+static urec_t *_top( ulog_t *log ) {
+
+  return ( log->n > 0 ) ? _record( log, log->n - 1 ) : NULL;
+}
+
+static char *_payload( urec_t *r ) {
+
+  return (char *)( r + 1 );
+}
+
+static void _clearLog( ulog_t *log ) {
+
+  free( log->buf );
+  free( log->at );
+  memset( log, 0, sizeof( ulog_t ));
+}
+
+/* Room for n More Bytes of Records */
+static void _reserveLog( ulog_t *log, size_t n ) {
+
+  if( log->used + n <= log->max )
+    return;
+
+  while( log->used + n > log->max )
+    log->max = log->max ? log->max * 2 : 4096;
+
+  if(( log->buf = realloc( log->buf, log->max )) == NULL )
+    die( "_reserveLog: realloc failed" );
+}
+
+/* Log the Change Being Made Goes In, Emptying Redo on a New Edit */
+static ulog_t *_log( void ) {
+
+  if( U.mode == UUNDO )
+    return &REDO;
+
+  if( U.mode == UNORMAL && REDO.n > 0 )
+    _clearLog( &REDO );
+
+  return &UNDO;
+}
+
+/* Append a Record With Room for size Bytes of Payload */
+static urec_t *_newRecord( ulog_t *log, enum _uop op, int row, int left, int len,
+			   size_t size ) {
+
+  urec_t *r;
+
+  _reserveLog( log, sizeof( urec_t ) + PADDED( size ));
+
+  if( log->n == log->maxN ) {
+    log->maxN = log->maxN ? log->maxN * 2 : 256;
+    if(( log->at = realloc( log->at, log->maxN * sizeof( size_t ))) == NULL )
+      die( "_newRecord: realloc failed" );
+  }
+
+  r = (urec_t *)( log->buf + log->used );
+  r->op   = op;
+  r->pad  = 0;
+  r->size = size;
+  r->step = U.step;
+  r->row  = row;
+  r->left = left;
+  r->len  = len;
+
+  log->at[ log->n++ ] = log->used;
+  log->used += sizeof( urec_t ) + PADDED( size );
+
+  return r;
+}
+
+/* Give the Last Record more Bytes of Payload, Return It */
+static urec_t *_growRecord( ulog_t *log, size_t more ) {
+
+  urec_t *r = _top( log );
+  size_t size = r->size + more;
+
+  _reserveLog( log, PADDED( size ) - PADDED( r->size ));
+
+  r = _top( log );
+  r->size   = size;
+  log->used = log->at[ log->n - 1 ] + sizeof( urec_t ) + PADDED( size );
+
+  return r;
+}
+
+static void _popRecord( ulog_t *log ) {
+
+  log->used = log->at[ --log->n ];
+}
+
+/* Drop the Oldest Steps of log Until over Bytes Are Gone */
+static void _dropSteps( ulog_t *log, size_t over ) {
+
+  int k = 0;
+  size_t cut;
+  unsigned long step;
+
+  while( k < log->n && log->at[k] < over ) {
+    step = _record( log, k )->step;
+    while( k < log->n && _record( log, k )->step == step )
+      k++;
+  }
+
+  if( k == log->n ) {
+    _clearLog( log );
+    return;
+  }
+
+  cut = log->at[k];
+  memmove( log->buf, log->buf + cut, log->used - cut );
+  memmove( log->at, log->at + k, ( log->n - k ) * sizeof( size_t ));
+  log->n    -= k;
+  log->used -= cut;
+
+  for( k = 0; k<log->n; k++ )
+    log->at[k] -= cut;
+}
+
+/* Copy n Bytes of row From col to dst */
+static void _copyText( int row, int col, int n, char *dst ) {
+
+  int len;
+  char *txt;
+
+  while( n > 0 ) {
+    txt = getBufferTextSpan( row, col, &len );
+    if( len > n ) len = n;
+    memcpy( dst, txt, len );
+    dst += len;
+    col += len;
+    n   -= len;
+  }
+}
+
+
+/*****************************************************************************************
+				       BUFFER HOOKS
+*****************************************************************************************/
+
+static bool _recordingP( void ) {
+
+  return ( U.onP && U.budget > 0 );
+}
+
+/* Extend the Last Record by a Splice Continuing It, If One Does */
+static bool _joinSplice( int row, int left, int right, int len ) {
+
+  urec_t *r = _top( &UNDO );
+  int gone = right - left;
+
+  if( U.mode != UNORMAL || r == NULL || r->op != USPLICE || r->row != row )
+    return false;
+
+  /* Only a Command Following the One That Logged r Continues It */
+  if( r->step != U.step && r->step != U.step - 1 )
+    return false;
+
+  /* Typing On */
+  if( gone == 0 && left == r->left + r->len )
+    r->len += len;
+
+  /* Deleting Backward */
+  else if( len == 0 && r->len == 0 && right == r->left ) {
+    r = _growRecord( &UNDO, gone );
+    memmove( _payload( r ) + gone, _payload( r ), r->size - gone );
+    _copyText( row, left, gone, _payload( r ));
+    r->left = left;
+  }
+
+  /* Deleting Forward */
+  else if( len == 0 && r->len == 0 && left == r->left ) {
+    r = _growRecord( &UNDO, gone );
+    _copyText( row, left, gone, _payload( r ) + r->size - gone );
+  }
+
+  else
+    return false;
+
+  r->step = U.step;
+  _clearLog( &REDO );
+
+  return true;
+}
+
+/* Columns left to right of row Are About to Become len Bytes */
+void undoSpliceRow( int row, int left, int right, int len ) {
+
+  urec_t *r;
+
+  if( !_recordingP() || _joinSplice( row, left, right, len ))
+    return;
+
+  r = _newRecord( _log(), USPLICE, row, left, len, right - left );
+  _copyText( row, left, right - left, _payload( r ));
+}
+
+/* n Rows Were Inserted Before row */
+void undoInsertRows( int row, int n ) {
+
+  ulog_t *log;
+  urec_t *r;
+
+  if( !_recordingP() || n <= 0 )
+    return;
+
+  log = _log();
+  r   = _top( log );
+
+  if( r && r->op == UINSERT && r->step == U.step && row == r->row + r->len )
+    r->len += n;
+  else
+    _newRecord( log, UINSERT, row, 0, n, 0 );
+}
+
+/* n Rows From row Are About to Be Deleted */
+void undoDeleteRows( int row, int n ) {
+
+  ulog_t *log;
+  urec_t *r;
+  size_t size = n * sizeof( row_t );
+
+  if( !_recordingP() || n <= 0 )
+    return;
+
+  log = _log();
+  r   = _top( log );
+
+  /* Rows Deleted One by One, as by a Region Kill */
+  if( r && r->op == UDELETE && r->step == U.step && r->row == row ) {
+    r = _growRecord( log, size );
+    holdBufferRows( row, n, (row_t *)( _payload( r ) + r->size - size ));
+    r->len += n;
+  }
+  else {
+    r = _newRecord( log, UDELETE, row, 0, n, size );
+    holdBufferRows( row, n, (row_t *)_payload( r ));
+  }
+}
+
+/* Let visit Change Every Row Held for Undo or Redo */
+void walkUndoRows( void (*visit)( row_t * )) {
+
+  ulog_t *logs[2] = { &UNDO, &REDO };
+  urec_t *r;
+  row_t *rows;
+  int i, j, k;
+
+  for( k = 0; k<2; k++ )
+    for( i = 0; i<logs[k]->n; i++ ) {
+      r = _record( logs[k], i );
+      if( r->op != UDELETE ) continue;
+      rows = (row_t *)_payload( r );
+      for( j = 0; j<r->len; j++ )
+	visit( &rows[j] );
+    }
+}
+
+
+/*****************************************************************************************
+				      UNDO AND REDO
+*****************************************************************************************/
+
+/* Start Recording Changes to a Freshly Read Buffer */
+void openUndo( void ) {
+
+  _clearLog( &UNDO );
+  _clearLog( &REDO );
+
+  U.onP      = true;
+  U.mode     = UNORMAL;
+  U.budget   = _undoBudget();
+  U.droppedP = false;
+}
+
+void closeUndo( void ) {
+
+  _clearLog( &UNDO );
+  _clearLog( &REDO );
+
+  U.onP = false;
+}
+
+/* A New Command Starts, Dropping the Oldest Steps Over Budget */
+void undoBoundary( void ) {
+
+  size_t total = UNDO.used + REDO.used;
+
+  U.step++;
+
+  if( total <= U.budget )
+    return;
+
+  _dropSteps( &UNDO, total - U.budget + U.budget / 4 );
+  U.droppedP = true;
+
+  if( UNDO.used + REDO.used > U.budget )
+    _dropSteps( &REDO, UNDO.used + REDO.used - U.budget );
+}
+
+size_t getUndoBytes( void ) {
+
+  return UNDO.used + REDO.used;
+}
+
+/* Apply the Inverse a Record Holds, false If the Buffer Doesn't Fit It */
+static bool _revert( urec_t *r ) {
+
+  int rows = getBufferNumRows();
+
+  switch( r->op ) {
+
+  case USPLICE:
+    if( r->row >= rows || r->left + r->len > getBufferLineLen( r->row ))
+      return false;
+    spliceBufferLineText( r->row, r->left, r->left + r->len, _payload( r ), r->size );
+    break;
+
+  case UINSERT:
+    if( r->row + r->len > rows )
+      return false;
+    freeBufferLines( r->row, r->len );
+    break;
+
+  case UDELETE:
+    if( r->row > rows )
+      return false;
+    restoreBufferRows( r->row, (row_t *)_payload( r ), r->len );
+    break;
+  }
+
+  return true;
+}
+
+/* Revert the Last Step of from, Logging It for the Other Direction */
+static void _revertStep( ulog_t *from, enum _um mode, const char *done,
+			 const char *none ) {
+
+  urec_t *r;
+  unsigned long step;
+  int row = INT_MAX, col = 0, left;
+
+  /* Pending Typing is a Change Too */
+  updateNavigationState();
+
+  if( !_recordingP() ) {
+    miniBufferMessage( "Undo is off" );
+    return;
+  }
+
+  if( from->n == 0 ) {
+    miniBufferMessage( none );
+    return;
+  }
+
+  U.mode = mode;
+  U.step++;
+
+  for( step = _top( from )->step; from->n > 0 && _top( from )->step == step; ) {
+    r = _top( from );
+    if( !_revert( r )) {
+      _clearLog( &UNDO );
+      _clearLog( &REDO );
+      U.mode = UNORMAL;
+      miniBufferMessage( "Undo information lost" );
+      return;
+    }
+    /* Point Goes to Where the Step's Change Starts */
+    left = ( r->op == USPLICE ) ? r->left : 0;
+    if( r->row < row || ( r->row == row && left < col )) {
+      row = r->row;
+      col = left;
+    }
+    _popRecord( from );
+  }
+
+  U.mode = UNORMAL;
+  U.step++;
+
+  setRegionActive( false );
+  pointToRowCol( row, col );
+  setStatusFlagModified();
+  miniBufferMessage( done );
+}
+
+void undoEdit( void ) {
+
+  _revertStep( &UNDO, UUNDO, "Undo",
+	       U.droppedP ? "No further undo information (AE_UNDO budget reached)"
+	       : "No further undo information" );
+}
+
+void redoEdit( void ) {
+
+  _revertStep( &REDO, UREDO, "Redo", "No further redo information" );
+}
+
+
+/***
+    Local Variables:
+    mode: c
+    tags-file-name: "~/ae/TAGS"
+    comment-column: 45
+    fill-column: 90
+    End:
+ ***/
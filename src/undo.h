@@ -0,0 +1,13 @@
+/* Undo Log */
+void openUndo( void );
+void closeUndo( void );
+void undoBoundary( void );
+void undoEdit( void );
+void redoEdit( void );
+size_t getUndoBytes( void );
+
+/* Buffer Hooks */
+void undoSpliceRow( int, int, int, int );
+void undoInsertRows( int, int );
+void undoDeleteRows( int, int );
+void walkUndoRows( void (*)( row_t * ));
@@ -0,0 +1,496 @@
+/***
+==========================================================================================
+                      _              _         _____    _ _ _
+                     / \   _ __   __| |_   _  | ____|__| (_) |_
+                    / _ \ | '_ \ / _` | | | | |  _| / _` | | __|
+                   / ___ \| | | | (_| | |_| | | |__| (_| | | |_
+                  /_/   \_\_| |_|\__,_|\__, | |_____\__,_|_|\__|  v0.5-beta
+                                       |___/
+
+        Copyright 2020 (andrew.suttles@gmail.com)
+        MIT LICENSE
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+ INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE 
+ LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT 
+ OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ DEALINGS IN THE SOFTWARE.
+
+ AndyEDIT is a simple, line-oriented, terminal-based text editor with emacs-like keybindings.
+
+ For more information about AndyEdit, see README.md.
+
+==========================================================================================
+ ***/
+#define _POSIX_C_SOURCE 200809L		     /* posix_fadvise() is POSIX */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <curses.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "ae.h"
+#include "minibuffer.h"
+#include "lineScan.h"
+#include "viewFile.h"
+
+/***
+    Read-Only File View
+
+    A file too large to hold in memory is viewed through windows.
+    Opening it scans the file once, a window at a time, and keeps a
+    sparse index: the byte offset and row of every PAGELINES'th line,
+    or sooner once a page passes PAGEBYTES.  Rows are found by binary
+    search of the index, then read from a decoded page; a page is its
+    own mapping of the file plus the offsets of its lines.  The last
+    VIEWPAGES pages used are kept, the oldest is dropped for a new one.
+
+    Paging, and reading pages in order as a search does, asks the
+    kernel to read the following pages ahead.
+***/
+
+/* Module Constants */
+#define VIEWWINDOW (1 << 26)		     /* Bytes Mapped per Index Window */
+#define PAGELINES  4096			     /* Most Lines per Page */
+#define PAGEBYTES  (1 << 20)		     /* Page Ends at the Next Line After */
+#define VIEWPAGES  64			     /* Decoded Pages Kept */
+
+/* Index Entry, Where a Page Starts */
+typedef struct {
+  off_t off;
+  int   row;
+} mark_t;
+
+/* Decoded Page */
+typedef struct {
+  int    page;				     /* Page Held, -1 if Free */
+  char  *map;				     /* Page Mapping */
+  size_t mapLen;
+  const char *txt;			     /* Page Text in the Mapping */
+  size_t *starts;			     /* Line Starts, Rows + 1 */
+  unsigned long used;			     /* Last Use, for LRU */
+} page_t;
+
+/* Module Private Data */
+static struct {
+  int     fd;				     /* -1 When No File is Viewed */
+  off_t   size;
+  int     rows;
+  mark_t *marks;			     /* Page Starts, Plus an End Mark */
+  int     pages;
+  int     maxMarks;
+  page_t  cache[VIEWPAGES];
+  int     last;				     /* Slot Used Last */
+  int     lastPage;			     /* Page Decoded Last */
+  unsigned long clock;
+} VIEW = { .fd = -1 };
+
+static struct {				     /* Index Scan of One Window */
+  const char *txt;
+  size_t len;
+  off_t  base;				     /* File Offset of Window */
+  bool   lastP;				     /* Window Reaches End of File */
+  size_t used;				     /* Bytes of Whole Lines Seen */
+  long   rows;
+  off_t  pageOff;			     /* Start of Page Being Filled */
+  long   pageRows;
+} SCAN;
+
+
+/*****************************************************************************************
+				     SPARSE LINE INDEX
+*****************************************************************************************/
+
+/* Record a Page Start */
+static void _pushMark( off_t off, long row ) {
+
+  if( VIEW.pages + 1 >= VIEW.maxMarks ) {
+    VIEW.maxMarks = VIEW.maxMarks ? VIEW.maxMarks * 2 : 1024;
+    if(( VIEW.marks = realloc( VIEW.marks, VIEW.maxMarks * sizeof( mark_t ))) == NULL )
+      die( "viewFile: marks realloc failed" );
+  }
+
+  VIEW.marks[ VIEW.pages ].off = off;
+  VIEW.marks[ VIEW.pages ].row = (int)row;
+}
+
+/* Count a Scanned Line, Closing the Page When Full */
+static void _scanRow( size_t off, size_t len ) {
+
+  /* Line Runs Past the Window, Next Window Starts With It */
+  if( !SCAN.lastP && off + len == SCAN.len && SCAN.txt[ off + len - 1 ] != '\n' )
+    return;
+
+  SCAN.used = off + len;
+  SCAN.rows++;
+  SCAN.pageRows++;
+
+  off_t end = SCAN.base + (off_t)( off + len );
+
+  if( SCAN.pageRows == PAGELINES || end - SCAN.pageOff >= PAGEBYTES ) {
+    VIEW.pages++;
+    _pushMark( end, SCAN.rows );
+    SCAN.pageOff  = end;
+    SCAN.pageRows = 0;
+  }
+}
+
+/* Map a Span of the File, Aligned Down to a Page Boundary */
+static char *_mapSpan( off_t off, size_t len, size_t *mapLen, const char **txt ) {
+
+  static long pageSize = 0;
+  char *map;
+
+  if( pageSize == 0 )
+    pageSize = sysconf( _SC_PAGESIZE );
+
+  off_t start = off - off % pageSize;
+
+  *mapLen = len + (size_t)( off - start );
+  map = mmap( NULL, *mapLen, PROT_READ, MAP_PRIVATE, VIEW.fd, start );
+  if( map == MAP_FAILED )
+    return NULL;
+
+  *txt = map + ( off - start );
+  return map;
+}
+
+/* Scan the File a Window at a Time */
+static bool _indexFile( const char *fn ) {
+
+  char msg[128];
+  const char *txt;
+  size_t mapLen, win = VIEWWINDOW;
+  off_t pos = 0;
+
+  memset( &SCAN, 0, sizeof( SCAN ));
+  VIEW.pages = 0;
+  _pushMark( 0, 0 );
+
+  while( pos < VIEW.size ) {
+
+    size_t len = ( VIEW.size - pos < (off_t)win ) ? (size_t)( VIEW.size - pos ) : win;
+    char *map  = _mapSpan( pos, len, &mapLen, &txt );
+
+    if( map == NULL )
+      return false;
+
+    posix_madvise( map, mapLen, POSIX_MADV_SEQUENTIAL );
+
+    SCAN.txt   = txt;
+    SCAN.len   = len;
+    SCAN.base  = pos;
+    SCAN.lastP = ( pos + (off_t)len == VIEW.size );
+    SCAN.used  = 0;
+
+    scanLines( txt, len, _scanRow );
+    munmap( map, mapLen );
+
+    if( SCAN.rows > INT_MAX )
+      return false;
+
+    /* No Whole Line in the Window, Widen It */
+    if( SCAN.used == 0 ) {
+      win *= 2;
+      continue;
+    }
+
+    pos += SCAN.used;
+    win  = VIEWWINDOW;
+
+    snprintf( msg, sizeof( msg ), "Indexing %s ... %d%%", fn,
+	      (int)( pos * 100 / VIEW.size ));
+    miniBufferMessage( msg );
+    refresh();
+  }
+
+  /* Close the Last Page With an End Mark */
+  if( SCAN.pageRows > 0 ) {
+    VIEW.pages++;
+    _pushMark( VIEW.size, SCAN.rows );
+  }
+
+  VIEW.rows = (int)SCAN.rows;
+  return true;
+}
+
+/* Find the Page Holding row */
+static int _findPage( int row ) {
+
+  int lo = 0, hi = VIEW.pages - 1;
+
+  while( lo < hi ) {
+    int mid = ( lo + hi + 1 ) / 2;
+
+    if( VIEW.marks[ mid ].row <= row ) lo = mid;
+    else hi = mid - 1;
+  }
+
+  return lo;
+}
+
+
+/*****************************************************************************************
+				    DECODED PAGE CACHE
+*****************************************************************************************/
+
+/* Ask the Kernel to Read Pages first .. last Ahead */
+static void _readAhead( int first, int last ) {
+
+  if( first < 0 )           first = 0;
+  if( last >= VIEW.pages )  last  = VIEW.pages - 1;
+  if( first > last )        return;
+
+  off_t off = VIEW.marks[ first ].off;
+
+  posix_fadvise( VIEW.fd, off, VIEW.marks[ last + 1 ].off - off, POSIX_FADV_WILLNEED );
+}
+
+/* Release a Cached Page */
+static void _dropPage( page_t *pg ) {
+
+  if( pg->page != -1 )
+    munmap( pg->map, pg->mapLen );
+
+  pg->page = -1;
+}
+
+/* Map and Split a Page Into Lines, Into the Least Recently Used Slot */
+static page_t *_decodePage( int page ) {
+
+  int slot = 0;
+  const char *txt, *nl;
+
+  for( int i = 1; i < VIEWPAGES; i++ )
+    if( VIEW.cache[i].used < VIEW.cache[ slot ].used )
+      slot = i;
+
+  page_t *pg = &VIEW.cache[ slot ];
+  _dropPage( pg );
+
+  if( pg->starts == NULL &&
+      ( pg->starts = malloc(( PAGELINES + 1 ) * sizeof( size_t ))) == NULL )
+    die( "viewFile: page malloc failed" );
+
+  off_t  off = VIEW.marks[ page ].off;
+  size_t len = (size_t)( VIEW.marks[ page + 1 ].off - off );
+  int    n   = VIEW.marks[ page + 1 ].row - VIEW.marks[ page ].row;
+
+  if(( pg->map = _mapSpan( off, len, &pg->mapLen, &pg->txt )) == NULL )
+    die( "viewFile: page mmap failed" );
+
+  /* Line Starts, the Last Line May Lack a '\n' */
+  txt = pg->txt;
+  pg->starts[0] = 0;
+  for( int i = 1; i <= n; i++ ) {
+    size_t at = pg->starts[ i - 1 ];
+    nl = memchr( txt + at, '\n', len - at );
+    pg->starts[i] = nl ? (size_t)( nl - txt ) + 1 : len;
+  }
+
+  /* Reading in Order, Keep the Kernel a Page Ahead */
+  if( page == VIEW.lastPage + 1 )
+    _readAhead( page + 1, page + 1 );
+
+  pg->page      = page;
+  VIEW.lastPage = page;
+  return pg;
+}
+
+/* Get the Decoded Page Holding row */
+static page_t *_pageOf( int row, int *line ) {
+
+  page_t *pg = &VIEW.cache[ VIEW.last ];
+
+  /* Most Lookups Fall in the Page Used Last */
+  if( pg->page == -1 || row < VIEW.marks[ pg->page ].row ||
+      row >= VIEW.marks[ pg->page + 1 ].row ) {
+
+    int page = _findPage( row );
+
+    pg = NULL;
+    for( int i = 0; i < VIEWPAGES; i++ )
+      if( VIEW.cache[i].page == page ) {
+	pg = &VIEW.cache[i];
+	break;
+      }
+
+    if( pg == NULL )
+      pg = _decodePage( page );
+
+    VIEW.last = (int)( pg - VIEW.cache );
+  }
+
+  pg->used = ++VIEW.clock;
+  *line    = row - VIEW.marks[ pg->page ].row;
+  return pg;
+}
+
+
+/*****************************************************************************************
+				      VIEW INTERFACE
+*****************************************************************************************/
+
+/* Index fn for Viewing, False If It Cannot Be Viewed */
+bool openFileView( const char *fn ) {
+
+  struct stat sb;
+
+  closeFileView();
+
+  if(( VIEW.fd = open( fn, O_RDONLY )) == -1 )
+    return false;
+
+  if( fstat( VIEW.fd, &sb ) == -1 || sb.st_size == 0 ) {
+    closeFileView();
+    return false;
+  }
+
+  VIEW.size = sb.st_size;
+
+  for( int i = 0; i < VIEWPAGES; i++ ) {
+    VIEW.cache[i].page = -1;
+    VIEW.cache[i].used = 0;
+  }
+  VIEW.last     = 0;
+  VIEW.lastPage = -1;
+  VIEW.clock    = 0;
+
+  if( !_indexFile( fn )) {
+    closeFileView();
+    return false;
+  }
+
+  return true;
+}
+
+/* Release the Viewed File */
+void closeFileView( void ) {
+
+  if( VIEW.fd == -1 ) return;
+
+  for( int i = 0; i < VIEWPAGES; i++ ) {
+    _dropPage( &VIEW.cache[i] );
+    free( VIEW.cache[i].starts );
+    VIEW.cache[i].starts = NULL;
+  }
+
+  free( VIEW.marks );
+  VIEW.marks    = NULL;
+  VIEW.maxMarks = 0;
+  VIEW.pages    = 0;
+  VIEW.rows     = 0;
+
+  close( VIEW.fd );
+  VIEW.fd = -1;
+}
+
+bool fileViewP( void ) {
+
+  return ( VIEW.fd != -1 );
+}
+
+int getFileViewRows( void ) {
+
+  return VIEW.rows;
+}
+
+int getFileViewLineLen( int row ) {
+
+  int line;
+  page_t *pg = _pageOf( row, &line );
+  size_t len = pg->starts[ line + 1 ] - pg->starts[ line ];
+
+  return len > INT_MAX ? INT_MAX : (int)len;
+}
+
+/* Bytes in the Viewed File */
+off_t getFileViewSize( void ) {
+
+  return VIEW.size;
+}
+
+/* File Offset of row */
+off_t getFileViewOffset( int row ) {
+
+  int line;
+  page_t *pg;
+
+  if( row >= VIEW.rows ) return VIEW.size;
+
+  pg = _pageOf( row, &line );
+  return VIEW.marks[ pg->page ].off + (off_t)pg->starts[ line ];
+}
+
+/* Row Holding File Offset *off, Which Becomes Its Offset in the Row */
+int findFileViewByte( off_t *off ) {
+
+  int lo = 0, hi = VIEW.pages - 1, line, n;
+  page_t *pg;
+
+  if( *off >= VIEW.size ) *off = VIEW.size - 1;
+  if( *off < 0 )          *off = 0;
+
+  /* Page by Binary Search of the Index, Then Line in the Page */
+  while( lo < hi ) {
+    int mid = ( lo + hi + 1 ) / 2;
+
+    if( VIEW.marks[ mid ].off <= *off ) lo = mid;
+    else hi = mid - 1;
+  }
+
+  pg = _pageOf( VIEW.marks[ lo ].row, &line );
+  n  = VIEW.marks[ lo + 1 ].row - VIEW.marks[ lo ].row;
+  *off -= VIEW.marks[ lo ].off;
+
+  for( lo = 0, hi = n - 1; lo < hi; ) {
+    int mid = ( lo + hi + 1 ) / 2;
+
+    if( pg->starts[ mid ] <= (size_t)*off ) lo = mid;
+    else hi = mid - 1;
+  }
+
+  *off -= (off_t)pg->starts[ lo ];
+  return VIEW.marks[ pg->page ].row + lo;
+}
+
+/* Row Text, Valid Until VIEWPAGES Other Pages are Read */
+const char *getFileViewLine( int row ) {
+
+  int line;
+  page_t *pg = _pageOf( row, &line );
+
+  return pg->txt + pg->starts[ line ];
+}
+
+/* Read the Pages of rows Rows From row Ahead */
+void prefetchFileView( int row, int rows ) {
+
+  if( VIEW.fd == -1 || VIEW.rows == 0 ) return;
+
+  if( row < 0 ) {
+    rows += row;
+    row   = 0;
+  }
+  if( rows <= 0 || row >= VIEW.rows ) return;
+
+  int last = ( rows > VIEW.rows - row ) ? VIEW.rows - 1 : row + rows - 1;
+
+  _readAhead( _findPage( row ), _findPage( last ));
+}
+
+/***
+    Local Variables:
+    mode: c
+    tags-file-name: "~/ae/TAGS"
+    comment-column: 45
+    fill-column: 90
+    End:
+ ***/
@@ -0,0 +1,11 @@
+/* Read-Only File View */
+bool openFileView( const char * );
+void closeFileView( void );
+bool fileViewP( void );
+int getFileViewRows( void );
+int getFileViewLineLen( int );
+off_t getFileViewSize( void );
+off_t getFileViewOffset( int );
+int findFileViewByte( off_t * );
+const char *getFileViewLine( int );
+void prefetchFileView( int, int );
@@ -0,0 +1,884 @@
+/***
+==========================================================================================
+                      _              _         _____    _ _ _
+                     / \   _ __   __| |_   _  | ____|__| (_) |_
+                    / _ \ | '_ \ / _` | | | | |  _| / _` | | __|
+                   / ___ \| | | | (_| | |_| | | |__| (_| | | |_
+                  /_/   \_\_| |_|\__,_|\__, | |_____\__,_|_|\__|  v0.5-beta
+                                       |___/
+
+        Copyright 2020 (andrew.suttles@gmail.com)
+        MIT LICENSE
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT
+ OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+
+ AndyEDIT is a simple, line-oriented, terminal-based text editor with emacs-like keybindings.
+
+ For more information about AndyEdit, see README.md.
+
+==========================================================================================
+ ***/
+#define _XOPEN_SOURCE 700		     /* posix_openpt(), mkdtemp() */
+
+#include <stdbool.h>
+#include <curses.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "ae.h"
+#include "buffer.h"
+#include "window.h"
+#include "files.h"
+#include "undo.h"
+#include "journal.h"
+
+/***
+    Buffer Test Driver
+
+    Runs random edits on a buffer and on a plain string beside it, and
+    compares the two after each.  Lines are short, long enough for the
+    ADD buffer, and past CHUNKLINE, so inline, piece and chunked rows
+    are all edited.  Edits are also undone and redone, and replayed
+    from the journal a crash left.  The editor runs on a pseudo
+    terminal, whose screen output is thrown away.  `make test` builds
+    and runs it; it prints each failure and exits non-zero if there was
+    one.
+***/
+
+/* Module Constants */
+#define STEPS    600			     /* Random Edits per Test */
+#define HEADROWS 100000			     /* Lines Kept by a Save in Place */
+#define LONGTEXT ( 3 << 19 )		     /* Past CHUNKLINE */
+#define SHORTMAX 24			     /* Most Bytes of a Short Edit */
+#define SPANMAX  40			     /* Most Rows a Region Spans */
+#define KILLMAX  32			     /* Kills the Kill Ring Keeps */
+
+/* Module Private Data */
+static struct {				     /* The Text the Buffer Should Hold */
+  char  *txt;
+  size_t len;
+  size_t max;
+} REF;
+
+static struct {				     /* The Kills the Ring Should Hold */
+  char  *txt[ KILLMAX ];
+  size_t len[ KILLMAX ];
+  int    n;
+  int    top;
+  int    at;				     /* Age of the Kill Last Yanked */
+  bool   yankP;				     /* May It Be Popped? */
+  size_t yankAt, yankLen;		     /* Text It Inserted */
+} RING;
+
+static char TESTDIR[] = "/tmp/aeTestXXXXXX"; /* Files Tests Read */
+static char TXT[ LONGTEXT + 1 ];	     /* Text Being Inserted, and a Newline */
+static unsigned long SEED = 1;
+static int MASTER = -1;			     /* Terminal the Editor Runs On */
+static int STEP;
+static int CHECKS;
+static int FAILS;
+
+/* Print Error Message and Exit */
+void die( const char *s ) {
+
+  perror( s );
+  exit( EXIT_FAILURE );
+}
+
+
+/*****************************************************************************************
+				     TEST HELPERS
+*****************************************************************************************/
+
+/* Random Number From 0 to n-1 */
+static int _rand( int n ) {
+
+  SEED = SEED * 6364136223846793005UL + 1442695040888963407UL;
+  return n > 0 ? (int)(( SEED >> 33 ) % (unsigned long)n ) : 0;
+}
+
+/* Count a Check, Reporting It If It Failed */
+static bool _check( bool okP, const char *what ) {
+
+  CHECKS++;
+  if( !okP ) {
+    FAILS++;
+    fprintf( stderr, "FAIL: %s (step %d)\n", what, STEP );
+  }
+
+  return okP;
+}
+
+/* Drain the Editor's Screen Output */
+static void *_drainTerminal( void *arg ) {
+
+  char buf[ 4096 ];
+
+  (void)arg;
+  while( read( MASTER, buf, sizeof( buf )) > 0 )
+    ;
+
+  return NULL;
+}
+
+/* Run the Editor on a Pseudo Terminal, Keys Are Typed at MASTER */
+static void _openTerminal( void ) {
+
+  pthread_t drain;
+  int slave;
+
+  if(( MASTER = posix_openpt( O_RDWR | O_NOCTTY )) == -1 ||
+     grantpt( MASTER ) == -1 || unlockpt( MASTER ) == -1 ||
+     ( slave = open( ptsname( MASTER ), O_RDWR | O_NOCTTY )) == -1 )
+    die( "_openTerminal: no pseudo terminal" );
+
+  if( dup2( slave, STDIN_FILENO ) == -1 || dup2( slave, STDOUT_FILENO ) == -1 )
+    die( "_openTerminal: dup2 failed" );
+  close( slave );
+
+  setenv( "TERM", "xterm-256color", 1 );
+  initializeTerminal();
+
+  if( pthread_create( &drain, NULL, _drainTerminal, NULL ) != 0 )
+    die( "_openTerminal: pthread_create failed" );
+  pthread_detach( drain );
+}
+
+/* Path of a Test File */
+static char *_path( const char *name ) {
+
+  static char path[ sizeof( TESTDIR ) + 32 ];
+
+  snprintf( path, sizeof( path ), "%s/%s", TESTDIR, name );
+  return path;
+}
+
+/* Write the Reference Text to a Test File and Read It Into the Buffer */
+static char *_readReference( const char *name ) {
+
+  char *fn = _path( name );
+  FILE *fp;
+
+  if(( fp = fopen( fn, "w" )) == NULL || fwrite( REF.txt, 1, REF.len, fp ) != REF.len ||
+     fclose( fp ) != 0 )
+    die( "_readReference: write failed" );
+
+  /* Killing the Buffer Empties Its Kill Ring */
+  killBuffer();
+  RING.n     = RING.top = RING.at = 0;
+  RING.yankP = false;
+  readBufferFile( fn );
+
+  return fn;
+}
+
+
+/*****************************************************************************************
+				    REFERENCE TEXT
+*****************************************************************************************/
+
+/* Replace n Bytes at at With len Bytes of txt */
+static void _refSplice( size_t at, size_t n, const char *txt, size_t len ) {
+
+  if( REF.len - n + len > REF.max ) {
+    REF.max = 2 * ( REF.len - n + len );
+    if(( REF.txt = realloc( REF.txt, REF.max )) == NULL )
+      die( "_refSplice: realloc failed" );
+  }
+
+  memmove( REF.txt + at + len, REF.txt + at + n, REF.len - at - n );
+  memcpy( REF.txt + at, txt, len );
+  REF.len += len - n;
+}
+
+/* Lines, the Last Maybe Without a Newline */
+static int _refRows( void ) {
+
+  int rows = 0;
+
+  for( char *p = REF.txt; ( p = memchr( p, '\n', REF.txt + REF.len - p )) != NULL; p++ )
+    rows++;
+
+  return ( REF.len > 0 && REF.txt[ REF.len - 1 ] != '\n' ) ? rows + 1 : rows;
+}
+
+/* Offset of Column col of row */
+static size_t _refOffset( int row, int col ) {
+
+  char *p = REF.txt;
+
+  while( row-- > 0 )
+    p = (char *)memchr( p, '\n', REF.txt + REF.len - p ) + 1;
+
+  return ( p - REF.txt ) + col;
+}
+
+/* Length of row, Less Its Newline */
+static int _refLen( int row ) {
+
+  size_t at = _refOffset( row, 0 );
+  char *nl  = memchr( REF.txt + at, '\n', REF.len - at );
+
+  return ( nl ? nl : REF.txt + REF.len ) - ( REF.txt + at );
+}
+
+/* Row and Column of Offset at */
+static int _refRowOf( size_t at, int *col ) {
+
+  int row = 0;
+  char *p, *bol = REF.txt;
+
+  while(( p = memchr( bol, '\n', REF.txt + at - bol )) != NULL ) {
+    bol = p + 1;
+    row++;
+  }
+
+  *col = REF.txt + at - bol;
+  return row;
+}
+
+/* Newlines in len Bytes of txt, and the Bytes After the Last */
+static int _lines( const char *txt, size_t len, int *tail ) {
+
+  int n = 0;
+
+  *tail = len;
+  for( size_t i = 0; i<len; i++ )
+    if( txt[i] == '\n' ) {
+      n++;
+      *tail = len - i - 1;
+    }
+
+  return n;
+}
+
+/* len Bytes of Text in TXT, With nl Newlines */
+static char *_randomText( size_t len, int nl ) {
+
+  for( size_t i = 0; i<len; i++ )
+    TXT[i] = ( _rand( 8 ) == 0 ) ? ' ' : 'a' + _rand( 26 );
+
+  while( nl-- > 0 && len > 0 )
+    TXT[ _rand( len ) ] = '\n';
+
+  return TXT;
+}
+
+/* Reference Text of Lines, Some Long Enough for the ADD Buffer or Chunks */
+static void _randomReference( int rows, bool longP ) {
+
+  size_t len;
+
+  REF.len = 0;
+  for( int i = 0; i<rows; i++ ) {
+    len = ( _rand( 4 ) == 0 ) ? 80 + _rand( 200 ) : _rand( SHORTMAX );
+    if( longP && i == rows / 2 )
+      len = LONGTEXT;
+    _randomText( len, 0 )[ len ] = '\n';
+    _refSplice( REF.len, 0, TXT, len + 1 );
+  }
+}
+
+/* Does File fn Hold the Reference Text? */
+static bool _sameFile( const char *fn, const char *what ) {
+
+  FILE *fp = fopen( fn, "r" );
+  char *txt;
+  bool okP;
+
+  if(( txt = malloc( REF.len + 1 )) == NULL )
+    die( "_sameFile: malloc failed" );
+
+  okP = fp && fread( txt, 1, REF.len + 1, fp ) == REF.len &&
+    memcmp( txt, REF.txt, REF.len ) == 0;
+
+  if( fp )
+    fclose( fp );
+  free( txt );
+
+  return _check( okP, what );
+}
+
+/* Does the Buffer Hold the Reference Text? */
+static bool _sameText( const char *what ) {
+
+  int rows = getBufferNumRows(), len, n;
+  size_t at = 0;
+  char *txt;
+
+  /* Splitting the Last Line at Its End Leaves an Empty Row */
+  if( rows > 0 && getBufferLineLen( rows - 1 ) == 0 )
+    rows--;
+
+  if( !_check( rows == _refRows() && getBufferBytes() == REF.len, what ))
+    return false;
+
+  for( int row = 0; row<rows; row++ )
+    for( int col = 0; col<getBufferLineLen( row ); col += n ) {
+      txt = getBufferTextSpan( row, col, &n );
+      len = getBufferLineLen( row ) - col;
+      if( n > len ) n = len;
+      if( !_check( n > 0 && at + n <= REF.len && memcmp( txt, REF.txt + at, n ) == 0,
+		   what ))
+	return false;
+      at += n;
+    }
+
+  return true;
+}
+
+/* FNV-1a Checksum of len Bytes, Continuing sum */
+static uint64_t _sum( uint64_t sum, const char *txt, size_t len ) {
+
+  for( size_t i = 0; i<len; i++ )
+    sum = ( sum ^ (unsigned char)txt[i] ) * 1099511628211UL;
+
+  return sum;
+}
+
+/* Pass Each Span of Buffer Text to visit */
+static void _walkText( void (*visit)( const char *, size_t, void * ), void *arg ) {
+
+  int rows = getBufferNumRows(), len, n;
+  char *txt;
+
+  for( int row = 0; row<rows; row++ )
+    for( int col = 0; col<getBufferLineLen( row ); col += n ) {
+      txt = getBufferTextSpan( row, col, &n );
+      len = getBufferLineLen( row ) - col;
+      visit( txt, n < len ? n : len, arg );
+    }
+}
+
+/* Checksum and Copy Callbacks */
+static void _sumSpan( const char *txt, size_t len, void *arg ) {
+
+  *(uint64_t *)arg = _sum( *(uint64_t *)arg, txt, len );
+}
+
+static void _refSpan( const char *txt, size_t len, void *arg ) {
+
+  (void)arg;
+  _refSplice( REF.len, 0, txt, len );
+}
+
+/* Checksum of the Buffer Text */
+static uint64_t _bufferSum( void ) {
+
+  uint64_t sum = 14695981039346656037UL;
+
+  _walkText( _sumSpan, &sum );
+  return sum;
+}
+
+/* Take the Buffer Text as the Reference */
+static void _refFromBuffer( void ) {
+
+  REF.len = 0;
+  _walkText( _refSpan, NULL );
+}
+
+
+/*****************************************************************************************
+				      RANDOM EDITS
+*****************************************************************************************/
+
+/* Keep a Kill in the Reference Ring */
+static void _refKill( size_t at, size_t len ) {
+
+  RING.top = ( RING.top + 1 ) % KILLMAX;
+  free( RING.txt[ RING.top ] );
+
+  if(( RING.txt[ RING.top ] = malloc( len )) == NULL )
+    die( "_refKill: malloc failed" );
+  memcpy( RING.txt[ RING.top ], REF.txt + at, len );
+  RING.len[ RING.top ] = len;
+
+  if( RING.n < KILLMAX )
+    RING.n++;
+  RING.yankP = false;
+}
+
+/* Insert the Kill at Age RING.at at (row,col), Checking Where It Ends */
+static void _yank( int row, int col, int endRow, int endCol ) {
+
+  int k = ( RING.top - RING.at + KILLMAX ) % KILLMAX, tail;
+  int lines = _lines( RING.txt[k], RING.len[k], &tail );
+
+  RING.yankAt  = _refOffset( row, col );
+  RING.yankLen = RING.len[k];
+  RING.yankP   = true;
+  _refSplice( RING.yankAt, 0, RING.txt[k], RING.len[k] );
+
+  _check( endRow == row + lines && endCol == ( lines ? tail : col + tail ), "yank end" );
+}
+
+/* A Region From (row,col), Within the Last Line or Up to the Row Count */
+static void _randomRegion( int row, int col, int *endRow, int *endCol ) {
+
+  int rows = _refRows();
+
+  *endRow = row + _rand( rows - row < SPANMAX ? rows - row + 1 : SPANMAX );
+
+  if( *endRow == rows )
+    *endCol = 0;
+  else if( *endRow == row )
+    *endCol = col + _rand( _refLen( row ) - col + 1 );
+  else
+    *endCol = _rand( _refLen( *endRow ) + 1 );
+}
+
+/* One Random Edit, to the Buffer and the Reference Text; false If It Changed Nothing */
+static bool _randomEdit( void ) {
+
+  int rows = _refRows(), row = _rand( rows ), col = _rand( _refLen( row ) + 1 );
+  int endRow, endCol, n, tail;
+  size_t at = _refOffset( row, col ), len;
+  bool changedP = true;
+
+  STEP++;
+
+  switch( _rand( 10 )) {
+
+  case 0:				     /* Splice Within a Line */
+  case 1:
+  case 2:
+    endCol = col + _rand( _refLen( row ) - col + 1 );
+    len    = ( _rand( 60 ) == 0 ) ? LONGTEXT : (size_t)_rand( SHORTMAX );
+    spliceBufferLineText( row, col, endCol, _randomText( len, 0 ), len );
+    _refSplice( at, endCol - col, TXT, len );
+    changedP = endCol > col || len > 0;
+    break;
+
+  case 3:				     /* Insert Lines */
+  case 4:
+    len = 1 + _rand( ( _rand( 4 ) == 0 ) ? 2000 : SHORTMAX * 2 );
+    n   = _lines( _randomText( len, 1 + _rand( 4 )), len, &tail );
+    endRow = insertBufferText( row, col, TXT, len, &endCol );
+    _refSplice( at, 0, TXT, len );
+    _check( endRow == row + n && endCol == ( n ? tail : col + tail ), "insert end" );
+    break;
+
+  case 5:				     /* Delete a Region */
+    _randomRegion( row, col, &endRow, &endCol );
+    if( endRow == rows ) {
+      changedP = false;
+      break;
+    }
+    freeBufferText( row, col, endRow, endCol );
+    _refSplice( at, _refOffset( endRow, endCol ) - at, "", 0 );
+    changedP = endRow > row || endCol > col;
+    break;
+
+  case 6:				     /* Delete Lines, Keeping One */
+    n = 1 + _rand( rows - row < 3 ? rows - row : 3 );
+    if( n >= rows ) {
+      changedP = false;
+      break;
+    }
+    freeBufferLines( row, n );
+    _refSplice( _refOffset( row, 0 ), _refOffset( row + n, 0 ) - _refOffset( row, 0 ), "", 0 );
+    break;
+
+  case 7:				     /* Kill or Copy a Region, Then Yank It */
+  case 8:
+    _randomRegion( row, col, &endRow, &endCol );
+    if( !pushKillRegion( row, col, endRow, endCol )) {
+      changedP = false;
+      break;
+    }
+    _refKill( at, _refOffset( endRow, endCol ) - at );
+    if( endRow < rows && _rand( 2 )) {
+      freeBufferText( row, col, endRow, endCol );
+      _refSplice( at, RING.len[ RING.top ], "", 0 );
+    }
+    row = _rand( _refRows() );
+    col = _rand( _refLen( row ) + 1 );
+    RING.at = 0;
+    endRow  = yankKillRing( row, col, &endCol );
+    _yank( row, col, endRow, endCol );
+    return true;
+
+  case 9:				     /* Swap the Last Yank for an Older Kill */
+    if( !RING.yankP ) {
+      changedP = false;
+      break;
+    }
+    endRow = yankPopKillRing( &endCol );
+    _refSplice( RING.yankAt, RING.yankLen, "", 0 );
+    row     = _refRowOf( RING.yankAt, &col );
+    RING.at = ( RING.at + 1 ) % RING.n;
+    _yank( row, col, endRow, endCol );
+    return true;
+  }
+
+  RING.yankP = false;
+  return changedP;
+}
+
+
+/*****************************************************************************************
+					 TESTS
+*****************************************************************************************/
+
+/* Random Edits on Short, Long and Chunked Lines */
+static void _testEdits( void ) {
+
+  _randomReference( 400, true );
+  _readReference( "edits.txt" );
+
+  for( int i = 0; i<STEPS; i++ ) {
+    _randomEdit();
+    if( !_sameText( "edit" ))
+      return;
+  }
+}
+
+/* Lines Split Before the Newline, at the Start, and at the End of the Last */
+static void _testSplits( void ) {
+
+  int endCol;
+
+  REF.len = 0;
+  _refSplice( 0, 0, "one\ntwo", 7 );
+  _readReference( "splits.txt" );
+
+  insertBufferText( 0, 3, "!\n", 2, &endCol );
+  _refSplice( 3, 0, "!\n", 2 );
+  _sameText( "split before newline" );
+
+  insertBufferText( 0, 0, "x\n", 2, &endCol );
+  _refSplice( 0, 0, "x\n", 2 );
+  _sameText( "split at line start" );
+
+  _check( insertBufferText( 3, 3, "!\n", 2, &endCol ) == 4 && endCol == 0 &&
+	  getBufferNumRows() == 5 && getBufferLineLen( 4 ) == 0, "split at end" );
+  _refSplice( REF.len, 0, "!\n", 2 );
+  _sameText( "split at end" );
+}
+
+
+/* A Chunked Line Yanked Beside Itself, Each Copy Edited on Its Own */
+static void _testSharedChunks( void ) {
+
+  int endRow, endCol;
+
+  REF.len = 0;
+  _refSplice( 0, 0, "a\n", 2 );
+  _refSplice( 2, 0, _randomText( LONGTEXT, 0 ), LONGTEXT );
+  _refSplice( REF.len, 0, "\nb\n", 3 );
+  _readReference( "chunks.txt" );
+
+  spliceBufferLineText( 1, 100, 100, "xyz", 3 );
+  _refSplice( _refOffset( 1, 100 ), 0, "xyz", 3 );
+
+  pushKillRegion( 0, 1, 2, 0 );
+  _refKill( 1, _refOffset( 2, 0 ) - 1 );
+  RING.at = 0;
+  endRow  = yankKillRing( 2, 0, &endCol );
+  _yank( 2, 0, endRow, endCol );
+  _sameText( "chunked line yanked" );
+
+  /* Once the Ring Has Let Go of Them */
+  for( int i = 0; i<KILLMAX; i++ ) {
+    pushKillRegion( 0, 0, 0, 1 );
+    _refKill( 0, 1 );
+  }
+
+  for( int i = 0; i<8; i++ ) {
+    spliceBufferLineText( 1 + 2 * ( i % 2 ), 200 + i, 210 + i, "12345", 5 );
+    _refSplice( _refOffset( 1 + 2 * ( i % 2 ), 200 + i ), 10, "12345", 5 );
+    if( !_sameText( "shared chunked line edited" ))
+      return;
+  }
+}
+
+/* A Kill Cut From an Edited Line, Which Then Changes */
+static void _testHeldAddText( void ) {
+
+  int endRow, endCol;
+
+  REF.len = 0;
+  _refSplice( 0, 0, "a\nb\nc\n", 6 );
+  _readReference( "held.txt" );
+
+  /* The Line Is the Last ADD Text, Edited in Place */
+  spliceBufferLineText( 0, 1, 1, _randomText( SPANMAX, 0 ), SPANMAX );
+  _refSplice( 1, 0, TXT, SPANMAX );
+
+  pushKillRegion( 0, 5, 1, 1 );
+  _refKill( 5, _refOffset( 1, 1 ) - 5 );
+
+  for( int i = 0; i<4; i++ ) {
+    spliceBufferLineText( 0, 2, 3, "", 0 );
+    _refSplice( 2, 1, "", 0 );
+  }
+
+  RING.at = 0;
+  endRow  = yankKillRing( 2, 0, &endCol );
+  _yank( 2, 0, endRow, endCol );
+  _sameText( "kill of edited line yanked" );
+}
+
+/***
+    Edits Recovered From the Journal
+
+    A child process makes random edits, waits for the journal to be
+    synced, then exits without saving as a crash would, leaving the
+    text it reached in a file.  Reading the file again offers the edits,
+    and answered yes must rebuild that text.
+***/
+static void _testJournal( void ) {
+
+  char *fn, *ref;
+  FILE *fp;
+  pid_t pid;
+  size_t n;
+  int status;
+
+  _randomReference( 200, true );
+  fn  = strdup( _readReference( "journal.txt" ));
+  ref = strdup( _path( "journal.ref" ));
+  if( fn == NULL || ref == NULL )
+    die( "_testJournal: strdup failed" );
+
+  if(( pid = fork()) == -1 )
+    die( "_testJournal: fork failed" );
+
+  if( pid == 0 ) {
+    for( int i = 0; i<STEPS / 3; i++ )
+      _randomEdit();
+
+    if(( fp = fopen( ref, "w" )) == NULL || fwrite( REF.txt, 1, REF.len, fp ) != REF.len ||
+       fclose( fp ) != 0 )
+      _exit( EXIT_FAILURE );
+
+    sleep( 1 );
+    pollJournal();
+    _exit( FAILS ? EXIT_FAILURE : EXIT_SUCCESS );
+  }
+
+  if( waitpid( pid, &status, 0 ) == -1 ||
+      !_check( WIFEXITED( status ) && WEXITSTATUS( status ) == EXIT_SUCCESS,
+	       "journaled edits" ))
+    goto done;
+
+  /* The Text the Child Reached */
+  if(( fp = fopen( ref, "r" )) == NULL )
+    die( "_testJournal: fopen failed" );
+  REF.len = 0;
+  while(( n = fread( TXT, 1, LONGTEXT, fp )) > 0 )
+    _refSplice( REF.len, 0, TXT, n );
+  fclose( fp );
+
+  /* Answered at the Recovery Prompt */
+  if( write( MASTER, "y\r", 2 ) != 2 )
+    die( "_testJournal: write failed" );
+
+  killBuffer();
+  readBufferFile( fn );
+  _sameText( "journal replayed" );
+
+ done:
+  unlink( ref );
+  free( ref );
+  free( fn );
+}
+
+/***
+    Random Edits Undone, Then Redone
+
+    Each edit is its own command.  Undo must step back through every
+    text the buffer held, by checksum, and redo forward again to the
+    last.  An edit after undoing leaves nothing to redo.
+***/
+static void _testUndo( void ) {
+
+  uint64_t sum[ STEPS / 3 + 1 ];
+  size_t bytes[ STEPS / 3 + 1 ];
+  bool changedP;
+  int n = 0;
+
+  _randomReference( 200, true );
+  _readReference( "undo.txt" );
+  sum[0]   = _sum( 14695981039346656037UL, REF.txt, REF.len );
+  bytes[0] = REF.len;
+
+  for( int i = 0; i<STEPS / 3; i++ ) {
+    undoBoundary();
+    undoBoundary();
+    changedP = _randomEdit();
+    if( !_sameText( "edit" ))
+      return;
+    if( changedP ) {
+      n++;
+      sum[n]   = _sum( 14695981039346656037UL, REF.txt, REF.len );
+      bytes[n] = REF.len;
+    }
+  }
+
+  for( int i = n; i>0; i-- ) {
+    undoBoundary();
+    undoEdit();
+    if( !_check( getBufferBytes() == bytes[ i-1 ] && _bufferSum() == sum[ i-1 ], "undo" ))
+      return;
+  }
+
+  for( int i = 1; i<=n; i++ ) {
+    undoBoundary();
+    redoEdit();
+    if( !_check( getBufferBytes() == bytes[i] && _bufferSum() == sum[i], "redo" ))
+      return;
+  }
+  _sameText( "all redone" );
+
+  /* Undo a Few, Then Edit */
+  for( int i = 0; i<3 && i<n; i++ ) {
+    undoBoundary();
+    undoEdit();
+  }
+  _refFromBuffer();
+  RING.yankP = false;
+
+  undoBoundary();
+  undoBoundary();
+  while( !_randomEdit() )
+    ;
+
+  undoBoundary();
+  redoEdit();
+  _sameText( "redo after an edit" );
+}
+
+/***
+    A Save in Place Rewriting Chunked Lines
+
+    Two long lines after the head are chunked by an edit, so read the
+    file they are saved to.  One is then deleted, leaving copies held by
+    undo and the kill ring.  The save must copy the file text all three
+    read out first, and keep the file's inode.
+***/
+static void _testSaveInPlace( void ) {
+
+  struct stat was, now;
+  int endRow, endCol;
+  size_t at;
+  char *fn;
+
+  REF.len = 0;
+  for( int i = 0; i<HEADROWS; i++ ) {
+    _randomText( 99, 0 )[ 99 ] = '\n';
+    _refSplice( REF.len, 0, TXT, 100 );
+  }
+  for( int i = 0; i<2; i++ ) {
+    _randomText( LONGTEXT, 0 )[ LONGTEXT ] = '\n';
+    _refSplice( REF.len, 0, TXT, LONGTEXT + 1 );
+  }
+  _refSplice( REF.len, 0, "tail\n", 5 );
+
+  /* The Default Sync Policy Always Renames */
+  setenv( "AE_FSYNC", "file", 1 );
+
+  fn = _readReference( "inplace.txt" );
+  setFilename( fn );
+  stat( fn, &was );
+
+  for( int i = 0; i<2; i++ ) {
+    spliceBufferLineText( HEADROWS + i, 1000, 1000, "xyz", 3 );
+    _refSplice( _refOffset( HEADROWS + i, 1000 ), 0, "xyz", 3 );
+  }
+  undoBoundary();
+  undoBoundary();
+
+  /* Held by the Kill Ring, Then by Undo */
+  at = _refOffset( HEADROWS - 1, 99 );
+  pushKillRegion( HEADROWS - 1, 99, HEADROWS + 1, 0 );
+  _refKill( at, _refOffset( HEADROWS + 1, 0 ) - at );
+
+  at = _refOffset( HEADROWS, 0 );
+  freeBufferLines( HEADROWS, 1 );
+  _refSplice( at, RING.len[ RING.top ] - 1, "", 0 );
+  undoBoundary();
+  undoBoundary();
+
+  saveBuffer();
+  finishBufferSave();
+  stat( fn, &now );
+
+  _check( was.st_ino == now.st_ino, "save in place kept the inode" );
+  _sameFile( fn, "file saved in place" );
+  _sameText( "buffer saved in place" );
+
+  undoEdit();
+  _refSplice( at, 0, RING.txt[ RING.top ] + 1, RING.len[ RING.top ] - 1 );
+  _sameText( "undo after save in place" );
+
+  RING.at = 0;
+  endRow  = yankKillRing( 0, 0, &endCol );
+  _yank( 0, 0, endRow, endCol );
+  _sameText( "yank after save in place" );
+}
+
+
+/*****************************************************************************************
+				       MAIN PROGRAM
+*****************************************************************************************/
+
+int main( void ) {
+
+  if( mkdtemp( TESTDIR ) == NULL )
+    die( "main: mkdtemp failed" );
+
+  _openTerminal();
+  initializeBuffer();
+  openEmptyBuffer( DEFAULT );
+
+  _testSplits();
+  _testSharedChunks();
+  _testHeldAddText();
+  _testSaveInPlace();
+  _testJournal();
+  _testUndo();
+  _testEdits();
+
+  closeBuffer();
+  closeEditor();
+
+  for( int i = 0; i<KILLMAX; i++ )
+    free( RING.txt[i] );
+  free( REF.txt );
+
+  unlink( _path( "splits.txt" ));
+  unlink( _path( "chunks.txt" ));
+  unlink( _path( "held.txt" ));
+  unlink( _path( "inplace.txt" ));
+  unlink( _path( "journal.txt" ));
+  unlink( _path( "undo.txt" ));
+  unlink( _path( "edits.txt" ));
+  rmdir( TESTDIR );
+
+  fprintf( stderr, "bufferTest: %d checks, %d failed\n", CHECKS, FAILS );
+  return FAILS ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+
+/***
+    Local Variables:
+    mode: c
+    tags-file-name: "~/ae/TAGS"
+    comment-column: 45
+    fill-column: 90
+    End:
+ ***/